@@ -4,11 +4,18 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
 
 #include "HashTable.hpp"
 
 using namespace std;
 
+// Upper bound on the height of a tree with fewer than 2^31 nodes (about 1.44 * log2(n)),
+// the size of the path stack used by insert and remove
+#define AVL_MAX_HEIGHT 64
+
 // Structure defining a node in the AVL tree
 template <typename T1, typename T2>
 struct AVLNode {
@@ -18,8 +25,9 @@ struct AVLNode {
 	AVLNode<T1, T2>* right;
 	int height;
 
-	// Constructor
-	AVLNode(T1 key, T2 value) : key(key), value(value), left(nullptr), right(nullptr), height(1) {};
+	// Constructor, the key is forwarded and the value is constructed in place from the remaining arguments
+	template <typename K, typename... Args>
+	AVLNode(K&& key, Args&&... args) : key(std::forward<K>(key)), value(std::forward<Args>(args)...), left(nullptr), right(nullptr), height(1) {};
 };
 
 // AVL tree class
@@ -27,6 +35,7 @@ template <typename T1, typename T2>
 class AVL : public HashTable<T1,T2>{
 private:
 	AVLNode<T1,T2>* root;
+	int size;		// Number of nodes
 
 	int height(AVLNode<T1, T2>* node);
 	int balanceFactor(AVLNode<T1, T2>* node);
@@ -34,21 +43,50 @@ private:
 	AVLNode<T1, T2>* rotateRight(AVLNode<T1, T2>* node);
 	AVLNode<T1, T2>* rotateLeft(AVLNode<T1, T2>* node);
 	AVLNode<T1, T2>* balance(AVLNode<T1, T2>* node);
-	AVLNode<T1, T2>* insert(AVLNode<T1, T2>* node, T1 key, T2 value);
-	AVLNode<T1, T2>* findMin(AVLNode<T1, T2>* node);
-	AVLNode<T1, T2>* removeMin(AVLNode<T1, T2>* node);
-	AVLNode<T1, T2>* remove(AVLNode<T1, T2>* node, T1 key);
-	AVLNode<T1,T2>* search(AVLNode<T1, T2>* node, T1 key);
+	void rebalance(AVLNode<T1, T2>** path[], int depth);
+	template <typename K>
+	AVLNode<T1, T2>* findNode(const K& key) const;
+	template <typename K>
+	bool erase(const K& key);
+	AVLNode<T1, T2>* build(const vector<pair<T1, T2>>& items, size_t first, size_t last);
+	AVLNode<T1, T2>* clone(const AVLNode<T1, T2>* node);
+	void destroy();
 
 public:
 	// Constructor and Destructor
-	AVL(int size);
+	AVL(int size = 0);
+	template <typename Iterator>
+	AVL(Iterator first, Iterator last);
 	AVL(const AVL& other);
 	~AVL();
 
+	template <typename Iterator>
+	void build(Iterator first, Iterator last);
+
 	void insert(T1 key, T2 value) override;
 	void remove(T1 key) override;
-	T2 search(T1 key);
+
+	template <typename K, typename... Args>
+	bool emplace(K&& key, Args&&... args);
+
+	template <typename Function>
+	void drain(Function function);
+
+	T2* find(const T1& key) override;
+	bool tryRemove(const T1& key) override;
+
+	// Lookups with a key of any type comparable to T1 with <, e.g. std::string_view for std::string keys
+	using HashTable<T1, T2>::contains;
+	template <typename K>
+	T2* find(const K& key);
+	template <typename K>
+	bool contains(const K& key);
+	template <typename K>
+	bool tryRemove(const K& key);
+	int getSize() const;
+
+	template <typename Function>
+	void forEach(Function function) const;
 };
 
 // Function to calculate the height of a node
@@ -110,8 +148,8 @@ AVLNode<T1, T2>* AVL<T1, T2>::balance(AVLNode<T1, T2>* node) {
 	if (balanceFactor(node) == 2)
 	// Right heavy
 	{
-		if (balanceFactor(node->right) < 0)
-		// Right-Left case{
+		// Right-Left case
+		if (balanceFactor(node->right) < 0) {
 			// Right rotate the right child
 			node->right = rotateRight(node->right);
 		}
@@ -133,193 +171,317 @@ AVLNode<T1, T2>* AVL<T1, T2>::balance(AVLNode<T1, T2>* node) {
 	return node;
 }
 
-// Function to insert a key-value pair into the AVL tree
+// Function to rebalance the nodes on a path after an insert or a remove, deepest first.
+// path[i] is the link (root or a child pointer) holding the i-th node below the root, so a rotation
+// can replace the node in its parent. Stops as soon as a subtree keeps its height, nothing above it changes
 template<typename T1, typename T2>
-AVLNode<T1, T2>* AVL<T1, T2>::insert(AVLNode<T1, T2>* node, T1 key, T2 value) {
-	if (!node) {
-		// Create a new node if the node is null
-		return new AVLNode<T1, T2>(key, value);
-	}
-	if (key < node->key) {
-		// Insert into the left subtree if key is smaller
-		node->left = insert(node->left, key, value);
-	}
-	else if (key > node->key) {
-		// Insert into the right subtree if key is larger
-		node->right = insert(node->right, key, value);
-	}
-	else {
-		// If the key already exists, return the node
-		return node;
+void AVL<T1, T2>::rebalance(AVLNode<T1, T2>** path[], int depth) {
+	for (int i = depth - 1; i >= 0; i--) {
+		AVLNode<T1, T2>* node = *path[i];
+		int oldHeight = node->height;
+		*path[i] = balance(node);
+		if ((*path[i])->height == oldHeight) {
+			break;
+		}
 	}
-	// Balance the node after insertion
-	return balance(node);
 }
 
-// Function to find the minimum key node in the AVL tree
+// Function to find the node holding the key, nullptr if there is none
 template<typename T1, typename T2>
-AVLNode<T1, T2>* AVL<T1, T2>::findMin(AVLNode<T1, T2>* node) {
-	// Recursively find the leftmost node
-	return node->left ? findMin(node->left) : node;
+template<typename K>
+AVLNode<T1, T2>* AVL<T1, T2>::findNode(const K& key) const {
+	AVLNode<T1, T2>* node = root;
+	while (node) {
+		if (key < node->key) {
+			// Search in the left subtree if key is smaller
+			node = node->left;
+		}
+		else if (node->key < key) {
+			// Search in the right subtree if key is larger
+			node = node->right;
+		}
+		else {
+			// Return the node if key is found
+			return node;
+		}
+	}
+	return nullptr;
 }
 
-// Function to remove the node with the minimum key in the AVL tree
+// Function to build a perfectly balanced subtree from the sorted items in [first, last), returns its root.
+// The middle item becomes the root, so both halves differ in size by at most one
 template<typename T1, typename T2>
-AVLNode<T1, T2>* AVL<T1, T2>::removeMin(AVLNode<T1, T2>* node) {
-	if (!node->left) {
-		// If the left child is null, return the right child
-		return node->right;
+AVLNode<T1, T2>* AVL<T1, T2>::build(const vector<pair<T1, T2>>& items, size_t first, size_t last) {
+	if (first == last) {
+		return nullptr;
 	}
-	// Recursively remove the minimum node
-	node->left = removeMin(node->left);
-	// Balance the node after removal
-	return balance(node);
+	size_t middle = first + (last - first) / 2;
+	AVLNode<T1, T2>* node = new AVLNode<T1, T2>(items[middle].first, items[middle].second);
+	node->left = build(items, first, middle);
+	node->right = build(items, middle + 1, last);
+	updateHeight(node);
+	size++;
+	return node;
 }
 
-// Function to remove a key-value pair from the AVL tree
+// Function to copy a subtree node by node, heights included, returns the root of the copy
 template<typename T1, typename T2>
-AVLNode<T1, T2>* AVL<T1, T2>::remove(AVLNode<T1, T2>* node, T1 key) {
+AVLNode<T1, T2>* AVL<T1, T2>::clone(const AVLNode<T1, T2>* node) {
 	if (!node) {
-		// Return null if the node is null
 		return nullptr;
 	}
-	if (key < node->key) {
-		// Remove from the left subtree if key is smaller
-		node->left = remove(node->left, key);
-	}
-	else if (key > node->key) {
-		// Remove from the right subtree if key is larger
-		node->right = remove(node->right, key);
-	}
-	else {
-		AVLNode<T1, T2>* left = node->left;
-		AVLNode<T1, T2>* right = node->right;
-		// Delete the node
-		delete node;
-		if (!right) {
-			// If right child is null, return left child
-			return left;
-		}
-		// Find the minimum node in the right subtree
-		AVLNode<T1, T2>* min = findMin(right);
-		
-		// Remove the minimum node
-		min->right = removeMin(right);
-		
-		// Update left child
-		min->left = left;
-		
-		// Balance the node after removal
-		return balance(min);
-	}
-	// Balance the node after removal
-	return balance(node);
+	AVLNode<T1, T2>* copy = new AVLNode<T1, T2>(node->key, node->value);
+	copy->left = clone(node->left);
+	copy->right = clone(node->right);
+	copy->height = node->height;
+	return copy;
 }
 
-// Function to search for a key in the AVL tree
+// Constructor, the tree starts empty whatever the size. Nodes are allocated one by one, so there is nothing to reserve
 template<typename T1, typename T2>
-AVLNode<T1, T2>* AVL<T1, T2>::search(AVLNode<T1, T2>* node, T1 key) {
-	if (!node) {
-		// Return null if the node is null
-		return nullptr;
-	}
-	if (key < node->key) {
-		// Search in the left subtree if key is smaller
-		return search(node->left, key);
-	}
-	else if (key > node->key) {
-		// Search in the right subtree if key is larger
-		return search(node->right, key);
-	}
-	else {
-		// Return the node if key is found
-		return node;
-	}
+AVL<T1, T2>::AVL(int) : root(nullptr), size(0) {
+
 }
 
-// Constructor
+// Constructor building the tree from a range of key-value pairs, see build
 template<typename T1, typename T2>
-AVL<T1, T2>::AVL(int size) {
-	for (int i = 0; i < size; i++) {
-		// Insert default key-value pairs into the AVL tree
-		insert(T1(), T2());
-	}
+template<typename Iterator>
+AVL<T1, T2>::AVL(Iterator first, Iterator last) : root(nullptr), size(0) {
+	build(first, last);
 }
 
-// Copy constructor
+// Copy constructor, clones the structure of the other tree instead of inserting its keys again
 template <typename T1, typename T2>
-AVL<T1, T2>::AVL(const AVL& other) {
-	// Initialize a stack to perform a depth-first traversal of the other AVL tree
-	vector<AVLNode<T1, T2>*> stack;
+AVL<T1, T2>::AVL(const AVL& other) : root(nullptr), size(other.size) {
+	root = clone(other.root);
+}
 
-	// Start traversal from the root of the other AVL tree
-	stack.push_back(other.root);
+// Function to replace the contents of the tree with a range of key-value pairs.
+// Sorted input is built in linear time, unsorted input is sorted first. Of pairs with equal keys
+// only the first one is kept, as if they were inserted in order
+template<typename T1, typename T2>
+template<typename Iterator>
+void AVL<T1, T2>::build(Iterator first, Iterator last) {
+	vector<pair<T1, T2>> items(first, last);
+	auto keyLess = [](const pair<T1, T2>& a, const pair<T1, T2>& b) { return a.first < b.first; };
+	auto keyEqual = [](const pair<T1, T2>& a, const pair<T1, T2>& b) { return !(a.first < b.first) && !(b.first < a.first); };
 
-	 // Traverse the other AVL tree using a depth-first approach
+	if (!std::is_sorted(items.begin(), items.end(), keyLess)) {
+		std::stable_sort(items.begin(), items.end(), keyLess);
+	}
+	items.erase(std::unique(items.begin(), items.end(), keyEqual), items.end());
+
+	destroy();
+	root = build(items, 0, items.size());
+}
+
+// Function to delete every node
+template<typename T1, typename T2>
+void AVL<T1, T2>::destroy() {
+	vector<AVLNode<T1, T2>*> stack;
+	if (root) {
+		stack.push_back(root);
+	}
 	while (!stack.empty()) {
-		// Retrieve the current node from the stack
 		AVLNode<T1, T2>* node = stack.back();
-		// Remove the current node from the stack
 		stack.pop_back();
-
-		// If the current node has a left child, add it to the stack for traversal
 		if (node->left) {
 			stack.push_back(node->left);
 		}
-		// If the current node has a right child, add it to the stack for traversal
 		if (node->right) {
 			stack.push_back(node->right);
 		}
-		// Insert the key-value pair of the current node into the new AVL tree being constructed
-		insert(node->key, node->value);
+		// Delete each node
+		delete node;
 	}
+	root = nullptr;
+	size = 0;
 }
 
 // Destructor
 template<typename T1, typename T2>
 AVL<T1, T2>::~AVL() {
-	vector<AVLNode<T1, T2>*> stack;
-	stack.push_back(root);
-	while (!stack.empty()) {
-		AVLNode<T1, T2>* node = stack.back();
-		stack.pop_back();
-		if (node->left) {
-			stack.push_back(node->left);
+	destroy();
+}
+
+// Function to insert a key with a value constructed in place from the remaining arguments.
+// Walks down once, remembering the links it passed, then rebalances bottom up. If the key already
+// exists nothing is constructed and false is returned. The key is moved into the node if it is an rvalue
+template<typename T1, typename T2>
+template<typename K, typename... Args>
+bool AVL<T1, T2>::emplace(K&& key, Args&&... args) {
+	AVLNode<T1, T2>** path[AVL_MAX_HEIGHT];
+	int depth = 0;
+	AVLNode<T1, T2>** link = &root;
+	while (*link) {
+		path[depth++] = link;
+		if (key < (*link)->key) {
+			// Go into the left subtree if key is smaller
+			link = &(*link)->left;
 		}
-		if (node->right) {
-			stack.push_back(node->right);
+		else if ((*link)->key < key) {
+			// Go into the right subtree if key is larger
+			link = &(*link)->right;
+		}
+		else {
+			// If the key already exists, leave the tree as it is
+			return false;
 		}
-		// Delete each node
-		delete node;
 	}
+	*link = new AVLNode<T1, T2>(std::forward<K>(key), std::forward<Args>(args)...);
+	size++;
+	rebalance(path, depth);
+	return true;
 }
 
 // Function to insert a key-value pair into the AVL tree
 template<typename T1, typename T2>
 void AVL<T1, T2>::insert(T1 key, T2 value) {
-	// Insert into the AVL tree
-	root = insert(root, key, value);
+	emplace(std::move(key), std::move(value));
 }
 
 // Function to remove a key-value pair from the AVL tree
 template<typename T1, typename T2>
 void AVL<T1, T2>::remove(T1 key) {
-	// Remove from the AVL tree
-	root = remove(root, key);
+	tryRemove(key);
+}
+
+// Function to get a pointer to the value stored with the key, or nullptr if there is none
+template<typename T1, typename T2>
+T2* AVL<T1, T2>::find(const T1& key) {
+	AVLNode<T1, T2>* node = findNode(key);
+	return node ? &node->value : nullptr;
 }
 
-// Function to search for a key in the AVL tree
 template<typename T1, typename T2>
-T2 AVL<T1, T2>::search(T1 key) {
-	// Search for the key in the AVL tree
-	AVLNode<T1, T2>* node = search(root, key);
-	if (node) {
-		// If key is found, return its value
-		return node->value;
+template<typename K>
+T2* AVL<T1, T2>::find(const K& key) {
+	AVLNode<T1, T2>* node = findNode(key);
+	return node ? &node->value : nullptr;
+}
+
+template<typename T1, typename T2>
+template<typename K>
+bool AVL<T1, T2>::contains(const K& key) {
+	return findNode(key) != nullptr;
+}
+
+// Function to remove a key, returns false if the key is not in the tree
+template<typename T1, typename T2>
+bool AVL<T1, T2>::tryRemove(const T1& key) {
+	return erase(key);
+}
+
+template<typename T1, typename T2>
+template<typename K>
+bool AVL<T1, T2>::tryRemove(const K& key) {
+	return erase(key);
+}
+
+// Function to remove a key, returns false if the key is not in the tree. A node with two children is
+// replaced by the minimum of its right subtree, the path then continues down to that minimum
+template<typename T1, typename T2>
+template<typename K>
+bool AVL<T1, T2>::erase(const K& key) {
+	AVLNode<T1, T2>** path[AVL_MAX_HEIGHT];
+	int depth = 0;
+	AVLNode<T1, T2>** link = &root;
+	while (*link) {
+		if (key < (*link)->key) {
+			path[depth++] = link;
+			link = &(*link)->left;
+		}
+		else if ((*link)->key < key) {
+			path[depth++] = link;
+			link = &(*link)->right;
+		}
+		else {
+			break;
+		}
+	}
+	AVLNode<T1, T2>* node = *link;
+	if (!node) {
+		return false;
+	}
+	if (!node->right) {
+		// If right child is null, the left child takes the place of the node
+		*link = node->left;
+	}
+	else {
+		int nodeDepth = depth;
+		path[depth++] = link;
+		// Find the minimum node in the right subtree
+		AVLNode<T1, T2>** minLink = &node->right;
+		while ((*minLink)->left) {
+			path[depth++] = minLink;
+			minLink = &(*minLink)->left;
+		}
+		AVLNode<T1, T2>* min = *minLink;
+		// Unlink the minimum, then put it in place of the node with the same height
+		*minLink = min->right;
+		min->left = node->left;
+		min->right = node->right;
+		min->height = node->height;
+		*link = min;
+		// The link below the removed node now belongs to the minimum
+		if (depth > nodeDepth + 1) {
+			path[nodeDepth + 1] = &min->right;
+		}
 	}
+	// Delete the node
+	delete node;
+	size--;
+	rebalance(path, depth);
+	return true;
+}
 
-	// If key is not found, throw an exception
-	throw std::out_of_range("Key not found");
+// Function to get the number of nodes
+template<typename T1, typename T2>
+int AVL<T1, T2>::getSize() const {
+	return size;
+}
+
+// Function to call function(key, value) for every node, in key order
+template<typename T1, typename T2>
+template<typename Function>
+void AVL<T1, T2>::forEach(Function function) const {
+	vector<AVLNode<T1, T2>*> stack;
+	AVLNode<T1, T2>* node = root;
+	while (node || !stack.empty()) {
+		// Go down to the leftmost node not visited yet
+		while (node) {
+			stack.push_back(node);
+			node = node->left;
+		}
+		node = stack.back();
+		stack.pop_back();
+		function(node->key, node->value);
+		node = node->right;
+	}
+}
+
+// Function to call function(key, value) for every node in key order, handing over the key and the value
+// as rvalues, and delete the nodes on the way. The tree is empty afterwards
+template<typename T1, typename T2>
+template<typename Function>
+void AVL<T1, T2>::drain(Function function) {
+	vector<AVLNode<T1, T2>*> stack;
+	AVLNode<T1, T2>* node = root;
+	while (node || !stack.empty()) {
+		while (node) {
+			stack.push_back(node);
+			node = node->left;
+		}
+		node = stack.back();
+		stack.pop_back();
+		function(std::move(node->key), std::move(node->value));
+		// The left subtree is done, so the node can go before its right subtree is visited
+		AVLNode<T1, T2>* right = node->right;
+		delete node;
+		node = right;
+	}
+	root = nullptr;
+	size = 0;
 }
 
 #endif //!AVL_HPP
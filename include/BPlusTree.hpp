@@ -0,0 +1,433 @@
+#ifndef BPLUS_TREE_HPP
+#define BPLUS_TREE_HPP
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include "HashTable.hpp"
+
+#define BPLUS_NODE_BYTES 256	// Target size of the key array of a node, four cache lines
+
+// B+ tree: every key-value pair lives in a leaf, inner nodes only hold separator keys, and the leaves
+// are linked in key order for range scans. Nodes are wide, so a lookup in a million keys touches about
+// four nodes instead of twenty AVL nodes, and the keys of a node are searched in a few cache lines
+template <typename T1, typename T2>
+class BPlusTree : public HashTable<T1, T2> {
+private:
+	// Number of keys a node holds, sized so the keys (and values or children) fill BPLUS_NODE_BYTES
+	static constexpr int LEAF_CAPACITY = BPLUS_NODE_BYTES / (sizeof(T1) + sizeof(T2)) > 4 ? BPLUS_NODE_BYTES / (sizeof(T1) + sizeof(T2)) : 4;
+	static constexpr int INNER_CAPACITY = BPLUS_NODE_BYTES / (sizeof(T1) + sizeof(void*)) > 4 ? BPLUS_NODE_BYTES / (sizeof(T1) + sizeof(void*)) : 4;
+
+	struct Node {
+		bool isLeaf;
+		int count;	// Number of keys
+
+		Node(bool isLeaf) : isLeaf(isLeaf), count(0) {}
+	};
+
+	// Inner node: children[i] holds the keys below keys[i], children[count] the rest.
+	// Arrays have one slot of slack so a node can overflow before it is split
+	struct Inner : Node {
+		T1 keys[INNER_CAPACITY + 1];
+		Node* children[INNER_CAPACITY + 2];
+
+		Inner() : Node(false) {}
+	};
+
+	struct Leaf : Node {
+		T1 keys[LEAF_CAPACITY + 1];
+		T2 values[LEAF_CAPACITY + 1];
+		Leaf* prev;
+		Leaf* next;
+
+		Leaf() : Node(true), prev(nullptr), next(nullptr) {}
+	};
+
+	Node* root;
+	Leaf* first;	// Leftmost leaf
+	int size;	// Number of key-value pairs
+
+	static int lowerBound(const T1* keys, int count, const T1& key);
+	static int upperBound(const T1* keys, int count, const T1& key);
+
+	Leaf* findLeaf(const T1& key) const;
+	bool insert(Node* node, T1&& key, T2&& value, T1& splitKey, Node*& splitNode);
+	bool remove(Node* node, const T1& key);
+	void fixChild(Inner* parent, int index);
+	void destroy(Node* node);
+
+public:
+	BPlusTree(int size = 0);
+	BPlusTree(const BPlusTree&) = delete;
+	BPlusTree& operator=(const BPlusTree&) = delete;
+	~BPlusTree();
+
+	void insert(T1 key, T2 value) override;
+	void remove(T1 key) override;
+
+	T2* find(const T1& key) override;
+	bool tryRemove(const T1& key) override;
+	int getSize() const;
+
+	template <typename Function>
+	void forEach(Function function) const;
+	template <typename Function>
+	void forEachInRange(const T1& low, const T1& high, Function function) const;
+};
+
+// Constructor, the tree starts empty. The size only exists for interface compatibility with the tables
+template<typename T1, typename T2>
+BPlusTree<T1, T2>::BPlusTree(int) : root(nullptr), first(nullptr), size(0) {
+	Leaf* leaf = new Leaf();
+	root = leaf;
+	first = leaf;
+}
+
+// Destructor
+template<typename T1, typename T2>
+BPlusTree<T1, T2>::~BPlusTree() {
+	destroy(root);
+}
+
+// Function to delete a subtree
+template<typename T1, typename T2>
+void BPlusTree<T1, T2>::destroy(Node* node) {
+	if (!node->isLeaf) {
+		Inner* inner = static_cast<Inner*>(node);
+		for (int i = 0; i <= inner->count; i++) {
+			destroy(inner->children[i]);
+		}
+		delete inner;
+	}
+	else {
+		delete static_cast<Leaf*>(node);
+	}
+}
+
+// Function to find the first position whose key is not less than the key.
+// Arithmetic keys are counted with a branch free loop the compiler turns into SIMD compares,
+// which beats a binary search with its mispredicted branches on nodes this small
+template<typename T1, typename T2>
+int BPlusTree<T1, T2>::lowerBound(const T1* keys, int count, const T1& key) {
+	if (std::is_arithmetic<T1>::value) {
+		int position = 0;
+		for (int i = 0; i < count; i++) {
+			position += keys[i] < key;
+		}
+		return position;
+	}
+	return static_cast<int>(std::lower_bound(keys, keys + count, key) - keys);
+}
+
+// Function to find the first position whose key is greater than the key, see lowerBound
+template<typename T1, typename T2>
+int BPlusTree<T1, T2>::upperBound(const T1* keys, int count, const T1& key) {
+	if (std::is_arithmetic<T1>::value) {
+		int position = 0;
+		for (int i = 0; i < count; i++) {
+			position += !(key < keys[i]);
+		}
+		return position;
+	}
+	return static_cast<int>(std::upper_bound(keys, keys + count, key) - keys);
+}
+
+// Function to find the leaf that holds the key if it is in the tree
+template<typename T1, typename T2>
+typename BPlusTree<T1, T2>::Leaf* BPlusTree<T1, T2>::findLeaf(const T1& key) const {
+	Node* node = root;
+	while (!node->isLeaf) {
+		Inner* inner = static_cast<Inner*>(node);
+		node = inner->children[upperBound(inner->keys, inner->count, key)];
+	}
+	return static_cast<Leaf*>(node);
+}
+
+// Function to insert a key-value pair into a subtree. If the node overflows it is split in two:
+// the new right half is returned in splitNode, with the key separating it from the left half.
+// Key and value are moved into the leaf only once the key is known to be absent
+template<typename T1, typename T2>
+bool BPlusTree<T1, T2>::insert(Node* node, T1&& key, T2&& value, T1& splitKey, Node*& splitNode) {
+	splitNode = nullptr;
+
+	if (node->isLeaf) {
+		Leaf* leaf = static_cast<Leaf*>(node);
+		int position = lowerBound(leaf->keys, leaf->count, key);
+		// If the key already exists, do not insert
+		if (position < leaf->count && !(key < leaf->keys[position])) {
+			return false;
+		}
+		std::move_backward(leaf->keys + position, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+		std::move_backward(leaf->values + position, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+		leaf->keys[position] = std::move(key);
+		leaf->values[position] = std::move(value);
+		leaf->count++;
+
+		if (leaf->count > LEAF_CAPACITY) {
+			// Move the upper half to a new leaf linked right after this one
+			Leaf* right = new Leaf();
+			int half = leaf->count / 2;
+			right->count = leaf->count - half;
+			std::move(leaf->keys + half, leaf->keys + leaf->count, right->keys);
+			std::move(leaf->values + half, leaf->values + leaf->count, right->values);
+			leaf->count = half;
+
+			right->next = leaf->next;
+			right->prev = leaf;
+			if (leaf->next) {
+				leaf->next->prev = right;
+			}
+			leaf->next = right;
+
+			splitKey = right->keys[0];
+			splitNode = right;
+		}
+		return true;
+	}
+
+	Inner* inner = static_cast<Inner*>(node);
+	int index = upperBound(inner->keys, inner->count, key);
+	T1 childKey;
+	Node* childSplit;
+	if (!insert(inner->children[index], std::move(key), std::move(value), childKey, childSplit)) {
+		return false;
+	}
+	if (!childSplit) {
+		return true;
+	}
+
+	// Put the new child right after the one that was split
+	std::move_backward(inner->keys + index, inner->keys + inner->count, inner->keys + inner->count + 1);
+	std::move_backward(inner->children + index + 1, inner->children + inner->count + 1, inner->children + inner->count + 2);
+	inner->keys[index] = std::move(childKey);
+	inner->children[index + 1] = childSplit;
+	inner->count++;
+
+	if (inner->count > INNER_CAPACITY) {
+		// The middle key moves up, the keys and children after it go to a new node
+		Inner* right = new Inner();
+		int half = inner->count / 2;
+		right->count = inner->count - half - 1;
+		std::move(inner->keys + half + 1, inner->keys + inner->count, right->keys);
+		std::move(inner->children + half + 1, inner->children + inner->count + 1, right->children);
+		splitKey = inner->keys[half];
+		inner->count = half;
+		splitNode = right;
+	}
+	return true;
+}
+
+// Function to remove a key from a subtree. A child left with fewer than half of its capacity
+// borrows from or is merged with a sibling, so the tree stays balanced
+template<typename T1, typename T2>
+bool BPlusTree<T1, T2>::remove(Node* node, const T1& key) {
+	if (node->isLeaf) {
+		Leaf* leaf = static_cast<Leaf*>(node);
+		int position = lowerBound(leaf->keys, leaf->count, key);
+		if (position == leaf->count || key < leaf->keys[position]) {
+			return false;
+		}
+		std::move(leaf->keys + position + 1, leaf->keys + leaf->count, leaf->keys + position);
+		std::move(leaf->values + position + 1, leaf->values + leaf->count, leaf->values + position);
+		leaf->count--;
+		// Drop the key and value now, for types that own memory
+		leaf->keys[leaf->count] = T1();
+		leaf->values[leaf->count] = T2();
+		return true;
+	}
+
+	Inner* inner = static_cast<Inner*>(node);
+	int index = upperBound(inner->keys, inner->count, key);
+	if (!remove(inner->children[index], key)) {
+		return false;
+	}
+	Node* child = inner->children[index];
+	if (child->count < (child->isLeaf ? LEAF_CAPACITY : INNER_CAPACITY) / 2) {
+		fixChild(inner, index);
+	}
+	return true;
+}
+
+// Function to refill an underfull child: take one key from a sibling that can spare it,
+// otherwise merge the child with a sibling and drop their separator from the parent
+template<typename T1, typename T2>
+void BPlusTree<T1, T2>::fixChild(Inner* parent, int index) {
+	int minimum = (parent->children[index]->isLeaf ? LEAF_CAPACITY : INNER_CAPACITY) / 2;
+	Node* left = index > 0 ? parent->children[index - 1] : nullptr;
+	Node* right = index < parent->count ? parent->children[index + 1] : nullptr;
+	Node* child = parent->children[index];
+
+	if (child->isLeaf) {
+		Leaf* leaf = static_cast<Leaf*>(child);
+		if (left && left->count > minimum) {
+			// Borrow the last entry of the left sibling
+			Leaf* sibling = static_cast<Leaf*>(left);
+			std::move_backward(leaf->keys, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+			std::move_backward(leaf->values, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+			sibling->count--;
+			leaf->keys[0] = std::move(sibling->keys[sibling->count]);
+			leaf->values[0] = std::move(sibling->values[sibling->count]);
+			leaf->count++;
+			parent->keys[index - 1] = leaf->keys[0];
+		}
+		else if (right && right->count > minimum) {
+			// Borrow the first entry of the right sibling
+			Leaf* sibling = static_cast<Leaf*>(right);
+			leaf->keys[leaf->count] = std::move(sibling->keys[0]);
+			leaf->values[leaf->count] = std::move(sibling->values[0]);
+			leaf->count++;
+			std::move(sibling->keys + 1, sibling->keys + sibling->count, sibling->keys);
+			std::move(sibling->values + 1, sibling->values + sibling->count, sibling->values);
+			sibling->count--;
+			parent->keys[index] = sibling->keys[0];
+		}
+		else {
+			// Merge the right one of the pair into the left one and unlink it
+			int separator = left ? index - 1 : index;
+			Leaf* target = static_cast<Leaf*>(parent->children[separator]);
+			Leaf* source = static_cast<Leaf*>(parent->children[separator + 1]);
+			std::move(source->keys, source->keys + source->count, target->keys + target->count);
+			std::move(source->values, source->values + source->count, target->values + target->count);
+			target->count += source->count;
+			target->next = source->next;
+			if (source->next) {
+				source->next->prev = target;
+			}
+			delete source;
+
+			std::move(parent->keys + separator + 1, parent->keys + parent->count, parent->keys + separator);
+			std::move(parent->children + separator + 2, parent->children + parent->count + 1, parent->children + separator + 1);
+			parent->count--;
+		}
+		return;
+	}
+
+	Inner* node = static_cast<Inner*>(child);
+	if (left && left->count > minimum) {
+		// Rotate through the parent: its separator comes down, the last key of the left sibling goes up
+		Inner* sibling = static_cast<Inner*>(left);
+		std::move_backward(node->keys, node->keys + node->count, node->keys + node->count + 1);
+		std::move_backward(node->children, node->children + node->count + 1, node->children + node->count + 2);
+		node->keys[0] = parent->keys[index - 1];
+		node->children[0] = sibling->children[sibling->count];
+		node->count++;
+		parent->keys[index - 1] = sibling->keys[sibling->count - 1];
+		sibling->count--;
+	}
+	else if (right && right->count > minimum) {
+		// Rotate through the parent the other way
+		Inner* sibling = static_cast<Inner*>(right);
+		node->keys[node->count] = parent->keys[index];
+		node->children[node->count + 1] = sibling->children[0];
+		node->count++;
+		parent->keys[index] = sibling->keys[0];
+		std::move(sibling->keys + 1, sibling->keys + sibling->count, sibling->keys);
+		std::move(sibling->children + 1, sibling->children + sibling->count + 1, sibling->children);
+		sibling->count--;
+	}
+	else {
+		// Merge the pair around their separator, which comes down from the parent
+		int separator = left ? index - 1 : index;
+		Inner* target = static_cast<Inner*>(parent->children[separator]);
+		Inner* source = static_cast<Inner*>(parent->children[separator + 1]);
+		target->keys[target->count] = parent->keys[separator];
+		std::move(source->keys, source->keys + source->count, target->keys + target->count + 1);
+		std::move(source->children, source->children + source->count + 1, target->children + target->count + 1);
+		target->count += source->count + 1;
+		delete source;
+
+		std::move(parent->keys + separator + 1, parent->keys + parent->count, parent->keys + separator);
+		std::move(parent->children + separator + 2, parent->children + parent->count + 1, parent->children + separator + 1);
+		parent->count--;
+	}
+}
+
+// Function to insert a key-value pair into the tree, growing a new root if the old one was split
+template<typename T1, typename T2>
+void BPlusTree<T1, T2>::insert(T1 key, T2 value) {
+	T1 splitKey;
+	Node* splitNode;
+	if (!insert(root, std::move(key), std::move(value), splitKey, splitNode)) {
+		return;
+	}
+	size++;
+	if (splitNode) {
+		Inner* newRoot = new Inner();
+		newRoot->keys[0] = std::move(splitKey);
+		newRoot->children[0] = root;
+		newRoot->children[1] = splitNode;
+		newRoot->count = 1;
+		root = newRoot;
+	}
+}
+
+// Function to remove a key-value pair from the tree
+template<typename T1, typename T2>
+void BPlusTree<T1, T2>::remove(T1 key) {
+	tryRemove(key);
+}
+
+// Function to get a pointer to the value stored with the key, or nullptr if there is none
+template<typename T1, typename T2>
+T2* BPlusTree<T1, T2>::find(const T1& key) {
+	Leaf* leaf = findLeaf(key);
+	int position = lowerBound(leaf->keys, leaf->count, key);
+	if (position < leaf->count && !(key < leaf->keys[position])) {
+		return &leaf->values[position];
+	}
+	return nullptr;
+}
+
+// Function to remove a key, returns false if the key is not in the tree.
+// A root left with a single child is replaced by it, so the tree shrinks from the top
+template<typename T1, typename T2>
+bool BPlusTree<T1, T2>::tryRemove(const T1& key) {
+	if (!remove(root, key)) {
+		return false;
+	}
+	size--;
+	if (!root->isLeaf && root->count == 0) {
+		Inner* oldRoot = static_cast<Inner*>(root);
+		root = oldRoot->children[0];
+		delete oldRoot;
+	}
+	return true;
+}
+
+// Function to get the number of key-value pairs
+template<typename T1, typename T2>
+int BPlusTree<T1, T2>::getSize() const {
+	return size;
+}
+
+// Function to call function(key, value) for every pair, in key order, walking the leaf list
+template<typename T1, typename T2>
+template<typename Function>
+void BPlusTree<T1, T2>::forEach(Function function) const {
+	for (const Leaf* leaf = first; leaf; leaf = leaf->next) {
+		for (int i = 0; i < leaf->count; i++) {
+			function(leaf->keys[i], leaf->values[i]);
+		}
+	}
+}
+
+// Function to call function(key, value) for every pair with low <= key <= high, in key order
+template<typename T1, typename T2>
+template<typename Function>
+void BPlusTree<T1, T2>::forEachInRange(const T1& low, const T1& high, Function function) const {
+	const Leaf* leaf = findLeaf(low);
+	int position = lowerBound(leaf->keys, leaf->count, low);
+	for (; leaf; leaf = leaf->next, position = 0) {
+		for (; position < leaf->count; position++) {
+			if (high < leaf->keys[position]) {
+				return;
+			}
+			function(leaf->keys[position], leaf->values[position]);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,499 @@
+#ifndef BUCKETIZED_CUCKOO_TABLE_HPP
+#define BUCKETIZED_CUCKOO_TABLE_HPP
+
+#define BUCKET_SLOTS 4		// Number of slots in a bucket
+#define MAX_BFS_BUCKETS 512	// Number of buckets visited while looking for an eviction path before rehashing
+
+#include "HashTable.hpp"
+#include "Hasher.hpp"
+#include "Node.hpp"
+#include "Prefetch.hpp"
+
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <utility>
+
+// Set-associative variant of cuckoo hashing. Every key has two candidate buckets of BUCKET_SLOTS
+// slots each. When both are full, a breadth-first search finds the shortest chain of keys that can
+// each be moved to their other bucket, ending in a bucket with a free slot. This keeps the table
+// working at load factors above 90% where a one slot cuckoo table would already rehash
+template <typename T1, typename T2, typename Hash = Hasher<T1>>
+class BucketizedCuckooTable : public HashTable<T1, T2>
+{
+private:
+	// All slots of a bucket share one cache line for small keys and values. Bit i of the mask is set
+	// if slot i is in use, so a full or an empty bucket is recognized without looking at its slots
+	struct alignas(64) Bucket
+	{
+		Node<T1, T2> slots[BUCKET_SLOTS];
+		unsigned occupied = 0;
+
+		static const unsigned FULL = (1u << BUCKET_SLOTS) - 1;
+
+		bool isUsed(int slot) const { return (occupied >> slot) & 1; }
+	};
+
+	// A step of the breadth-first search: the slot of the parent bucket moved into this bucket
+	struct PathStep
+	{
+		size_t bucket;
+		int parent;
+		int slot;
+	};
+
+	std::vector<Bucket> buckets_;
+
+	size_t size_;		// Number of buckets
+	size_t elements_;
+	float loadFactor_;
+
+	std::vector<unsigned> visited_;		// Number of the last search that visited each bucket
+	unsigned search_;			// Number of the current breadth-first search
+
+	template <typename K>
+	size_t hash(const K& key, int type = 0);
+	size_t alternate(const T1& key, size_t bucket);
+	template <typename K>
+	int findSlot(size_t bucket, const K& key);
+	template <typename K>
+	T2* lookup(const K& key, size_t bucket1, size_t bucket2);
+	template <typename K>
+	bool erase(const K& key, size_t bucket1, size_t bucket2);
+	void insertHashed(T1&& key, T2&& value, size_t bucket1, size_t bucket2);
+	template <typename Operation>
+	void forEachBatch(const T1* keys, size_t count, Operation operation);
+	int findFreeSlot(size_t bucket);
+	bool findPath(size_t bucket1, size_t bucket2, std::vector<PathStep>& path);
+	bool place(T1& key, T2& value, size_t bucket1, size_t bucket2);
+
+	bool rebuild(std::vector<Node<T1, T2>>& entries, size_t size);
+	void rehash();
+
+public:
+	BucketizedCuckooTable(size_t size);
+	~BucketizedCuckooTable();
+
+	void insert(T1 key, T2 value) override;
+	void remove(T1 key) override;
+	T2* find(const T1& key) override;
+	bool tryRemove(const T1& key) override;
+	void display();
+
+	void findBatch(const T1* keys, size_t count, T2** values) override;
+	void insertBatch(const T1* keys, const T2* values, size_t count) override;
+	size_t removeBatch(const T1* keys, size_t count) override;
+
+	// Lookups with any key type a transparent hasher accepts, e.g. std::string_view for std::string keys
+	using HashTable<T1, T2>::contains;
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	T2* find(const K& key) { return lookup(key, hash(key, 0), hash(key, 1)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const K& key) { return lookup(key, hash(key, 0), hash(key, 1)) != nullptr; }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool tryRemove(const K& key) { return erase(key, hash(key, 0), hash(key, 1)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	void remove(const K& key) { erase(key, hash(key, 0), hash(key, 1)); }
+
+	float calculateLoadFactor();
+};
+
+// Initialize enough buckets to hold the specified number of elements
+template <typename T1, typename T2, typename Hash>
+BucketizedCuckooTable<T1, T2, Hash>::BucketizedCuckooTable(size_t size) : size_((size + BUCKET_SLOTS - 1) / BUCKET_SLOTS), elements_(0), loadFactor_(0.0), search_(0)
+{
+	if (size_ == 0)
+		size_ = 1;
+
+	buckets_.resize(size_);
+	visited_.resize(size_);
+}
+
+template <typename T1, typename T2, typename Hash>
+BucketizedCuckooTable<T1, T2, Hash>::~BucketizedCuckooTable()
+{
+	buckets_.clear();
+}
+
+// Calculate bucket index, type selects one of two independently seeded hash functions
+template <typename T1, typename T2, typename Hash>
+template <typename K>
+size_t BucketizedCuckooTable<T1, T2, Hash>::hash(const K& key, int type)
+{
+	Hash hashFunction;
+
+	return hashFunction(key, type == 0 ? 0 : 0x9e3779b97f4a7c15ULL) % size_;
+}
+
+// Get the other candidate bucket of a key stored in the specified bucket
+template <typename T1, typename T2, typename Hash>
+size_t BucketizedCuckooTable<T1, T2, Hash>::alternate(const T1& key, size_t bucket)
+{
+	size_t bucket1 = hash(key, 0);
+
+	return bucket == bucket1 ? hash(key, 1) : bucket1;
+}
+
+// Return a slot of the bucket holding the key, or -1
+template <typename T1, typename T2, typename Hash>
+template <typename K>
+int BucketizedCuckooTable<T1, T2, Hash>::findSlot(size_t bucket, const K& key)
+{
+	const Bucket& candidate = buckets_[bucket];
+
+	for (int i = 0; i < BUCKET_SLOTS; i++)
+	{
+		if (candidate.isUsed(i) && candidate.slots[i].key == key)
+			return i;
+	}
+
+	return -1;
+}
+
+// Return an empty slot of the bucket, or -1
+template <typename T1, typename T2, typename Hash>
+int BucketizedCuckooTable<T1, T2, Hash>::findFreeSlot(size_t bucket)
+{
+	unsigned occupied = buckets_[bucket].occupied;
+
+	if (occupied == Bucket::FULL)
+		return -1;
+
+	for (int i = 0; i < BUCKET_SLOTS; i++)
+	{
+		if (!((occupied >> i) & 1))
+			return i;
+	}
+
+	return -1;
+}
+
+// Breadth-first search from both candidate buckets for the closest bucket with a free slot.
+// On success the path holds the visited steps and its last element is the bucket with a free slot
+template <typename T1, typename T2, typename Hash>
+bool BucketizedCuckooTable<T1, T2, Hash>::findPath(size_t bucket1, size_t bucket2, std::vector<PathStep>& path)
+{
+	path.clear();
+	search_++;
+
+	// A bucket appears on the path only once, so moves along the path never touch the same slot twice
+	path.push_back({ bucket1, -1, -1 });
+	visited_[bucket1] = search_;
+
+	if (visited_[bucket2] != search_)
+	{
+		path.push_back({ bucket2, -1, -1 });
+		visited_[bucket2] = search_;
+	}
+
+	for (int head = 0; head < static_cast<int>(path.size()) && path.size() < MAX_BFS_BUCKETS; head++)
+	{
+		size_t bucket = path[head].bucket;
+
+		// Every key of a full bucket could move to its other bucket
+		for (int i = 0; i < BUCKET_SLOTS; i++)
+		{
+			size_t next = alternate(buckets_[bucket].slots[i].key, bucket);
+
+			if (visited_[next] == search_)
+				continue;
+
+			path.push_back({ next, head, i });
+			visited_[next] = search_;
+
+			if (findFreeSlot(next) != -1)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+template <typename T1, typename T2, typename Hash>
+void BucketizedCuckooTable<T1, T2, Hash>::insert(T1 key, T2 value)
+{
+	size_t bucket1 = hash(key, 0);
+	size_t bucket2 = hash(key, 1);
+
+	insertHashed(std::move(key), std::move(value), bucket1, bucket2);
+}
+
+// Insert key-value pair into one of its two buckets. If there is no eviction path for it the table grows
+// until there is one. bucket1 and bucket2 are the buckets of the key in the table as it is now
+template <typename T1, typename T2, typename Hash>
+void BucketizedCuckooTable<T1, T2, Hash>::insertHashed(T1&& key, T2&& value, size_t bucket1, size_t bucket2)
+{
+	// If key is already present, do not insert
+	if (findSlot(bucket1, key) != -1 || findSlot(bucket2, key) != -1)
+		return;
+
+	// No eviction path within the search limit, grow the table and try again
+	while (!place(key, value, bucket1, bucket2))
+	{
+		rehash();
+		bucket1 = hash(key, 0);
+		bucket2 = hash(key, 1);
+	}
+
+	elements_++;
+}
+
+// Put a key that is not in the table into one of its two buckets, moving other keys along an eviction path
+// if both are full. Never grows the table: if there is no path it returns false and leaves the table, key and
+// value as they were. Otherwise key and value are moved into the slot
+template <typename T1, typename T2, typename Hash>
+bool BucketizedCuckooTable<T1, T2, Hash>::place(T1& key, T2& value, size_t bucket1, size_t bucket2)
+{
+	if (findFreeSlot(bucket1) == -1 && findFreeSlot(bucket2) == -1)
+	{
+		std::vector<PathStep> path;
+
+		if (!findPath(bucket1, bucket2, path))
+			return false;
+
+		// Walk the path backwards, moving every key into the free slot of the next bucket
+		int step = static_cast<int>(path.size()) - 1;
+
+		while (path[step].parent != -1)
+		{
+			Bucket& from = buckets_[path[path[step].parent].bucket];
+			Bucket& to = buckets_[path[step].bucket];
+			int free = findFreeSlot(path[step].bucket);
+
+			std::swap(to.slots[free], from.slots[path[step].slot]);
+			to.occupied |= 1u << free;
+			from.occupied &= ~(1u << path[step].slot);
+
+			step = path[step].parent;
+		}
+	}
+
+	size_t bucket = findFreeSlot(bucket1) != -1 ? bucket1 : bucket2;
+	int slot = findFreeSlot(bucket);
+	Node<T1, T2>& node = buckets_[bucket].slots[slot];
+
+	node.key = std::move(key);
+	node.value = std::move(value);
+	buckets_[bucket].occupied |= 1u << slot;
+
+	return true;
+}
+
+// Remove the key, nothing happens if it is not there
+template <typename T1, typename T2, typename Hash>
+void BucketizedCuckooTable<T1, T2, Hash>::remove(T1 key)
+{
+	tryRemove(key);
+}
+
+template <typename T1, typename T2, typename Hash>
+bool BucketizedCuckooTable<T1, T2, Hash>::tryRemove(const T1& key)
+{
+	return erase(key, hash(key, 0), hash(key, 1));
+}
+
+// Find the key in one of its buckets and remove it by reseting a node to default values
+template <typename T1, typename T2, typename Hash>
+template <typename K>
+bool BucketizedCuckooTable<T1, T2, Hash>::erase(const K& key, size_t bucket1, size_t bucket2)
+{
+	size_t buckets[2] = { bucket1, bucket2 };
+
+	for (size_t bucket : buckets)
+	{
+		int slot = findSlot(bucket, key);
+
+		if (slot != -1)
+		{
+			buckets_[bucket].slots[slot] = Node<T1, T2>();
+			buckets_[bucket].occupied &= ~(1u << slot);
+
+			elements_--;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template <typename T1, typename T2, typename Hash>
+T2* BucketizedCuckooTable<T1, T2, Hash>::find(const T1& key)
+{
+	return lookup(key, hash(key, 0), hash(key, 1));
+}
+
+// Return a pointer to the value associated with the key, or nullptr
+template <typename T1, typename T2, typename Hash>
+template <typename K>
+T2* BucketizedCuckooTable<T1, T2, Hash>::lookup(const K& key, size_t bucket1, size_t bucket2)
+{
+	size_t buckets[2] = { bucket1, bucket2 };
+
+	for (size_t bucket : buckets)
+	{
+		int slot = findSlot(bucket, key);
+
+		if (slot != -1)
+			return &buckets_[bucket].slots[slot].value;
+	}
+
+	return nullptr;
+}
+
+// Call operation(i, bucket1, bucket2) for every key, a batch of keys at a time. Both buckets of every key
+// of a batch are computed and prefetched before the first of them is resolved; a bucket fills one cache
+// line for small keys and values, mask included. The buckets of a key depend on the number of buckets,
+// they are computed again for the keys left in a batch when an insert of it grows the table
+template <typename T1, typename T2, typename Hash>
+template <typename Operation>
+void BucketizedCuckooTable<T1, T2, Hash>::forEachBatch(const T1* keys, size_t count, Operation operation)
+{
+	size_t buckets[PREFETCH_BATCH][2];
+
+	for (size_t start = 0; start < count; start += PREFETCH_BATCH)
+	{
+		size_t batch = count - start < PREFETCH_BATCH ? count - start : PREFETCH_BATCH;
+		size_t tableSize = size_;
+
+		for (size_t i = 0; i < batch; i++)
+		{
+			buckets[i][0] = hash(keys[start + i], 0);
+			buckets[i][1] = hash(keys[start + i], 1);
+			prefetchLine(&buckets_[buckets[i][0]]);
+			prefetchLine(&buckets_[buckets[i][1]]);
+		}
+
+		for (size_t i = 0; i < batch; i++)
+		{
+			if (size_ != tableSize)
+			{
+				buckets[i][0] = hash(keys[start + i], 0);
+				buckets[i][1] = hash(keys[start + i], 1);
+			}
+
+			operation(start + i, buckets[i][0], buckets[i][1]);
+		}
+	}
+}
+
+template <typename T1, typename T2, typename Hash>
+void BucketizedCuckooTable<T1, T2, Hash>::findBatch(const T1* keys, size_t count, T2** values)
+{
+	forEachBatch(keys, count, [this, keys, values](size_t i, size_t bucket1, size_t bucket2) { values[i] = lookup(keys[i], bucket1, bucket2); });
+}
+
+template <typename T1, typename T2, typename Hash>
+void BucketizedCuckooTable<T1, T2, Hash>::insertBatch(const T1* keys, const T2* values, size_t count)
+{
+	forEachBatch(keys, count, [this, keys, values](size_t i, size_t bucket1, size_t bucket2) { insertHashed(T1(keys[i]), T2(values[i]), bucket1, bucket2); });
+}
+
+// Remove every key of the array that is there, return the number of keys removed
+template <typename T1, typename T2, typename Hash>
+size_t BucketizedCuckooTable<T1, T2, Hash>::removeBatch(const T1* keys, size_t count)
+{
+	size_t removed = 0;
+
+	forEachBatch(keys, count, [this, keys, &removed](size_t i, size_t bucket1, size_t bucket2)
+	{
+		if (erase(keys[i], bucket1, bucket2))
+			removed++;
+	});
+
+	return removed;
+}
+
+template <typename T1, typename T2, typename Hash>
+float BucketizedCuckooTable<T1, T2, Hash>::calculateLoadFactor()
+{
+	loadFactor_ = static_cast<float>(elements_) / (size_ * BUCKET_SLOTS);
+
+	return loadFactor_;
+}
+
+// Double the number of buckets and move every element into the new table. The elements are taken out of
+// the buckets first, so that if one of them finds no slot the rebuild starts over at twice the size again.
+// Empty buckets are passed over by their mask
+template <typename T1, typename T2, typename Hash>
+void BucketizedCuckooTable<T1, T2, Hash>::rehash()
+{
+	std::vector<Node<T1, T2>> entries;
+	entries.reserve(elements_);
+
+	for (size_t i = 0; i < size_; i++)
+	{
+		if (buckets_[i].occupied == 0)
+			continue;
+
+		for (int j = 0; j < BUCKET_SLOTS; j++)
+		{
+			if (buckets_[i].isUsed(j))
+				entries.push_back(std::move(buckets_[i].slots[j]));
+		}
+	}
+
+	size_t size = size_ * 2;
+
+	while (!rebuild(entries, size))
+		size *= 2;
+}
+
+// Place the entries into the specified number of empty buckets, without ever growing. If an entry finds
+// no slot, the entries placed so far are taken back out of the buckets so that entries again holds
+// every element, and false is returned
+template <typename T1, typename T2, typename Hash>
+bool BucketizedCuckooTable<T1, T2, Hash>::rebuild(std::vector<Node<T1, T2>>& entries, size_t size)
+{
+	buckets_.assign(size, Bucket());
+	visited_.assign(size, 0);
+	search_ = 0;
+	size_ = size;
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (place(entries[i].key, entries[i].value, hash(entries[i].key, 0), hash(entries[i].key, 1)))
+			continue;
+
+		// The entries before i are somewhere in the buckets, the others were not touched
+		size_t placed = 0;
+
+		for (size_t j = 0; j < size_; j++)
+		{
+			for (int k = 0; k < BUCKET_SLOTS; k++)
+			{
+				if (buckets_[j].isUsed(k))
+					entries[placed++] = std::move(buckets_[j].slots[k]);
+			}
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+// Display every non empty bucket
+template <typename T1, typename T2, typename Hash>
+void BucketizedCuckooTable<T1, T2, Hash>::display()
+{
+	for (size_t i = 0; i < size_; i++)
+	{
+		if (buckets_[i].occupied == 0)
+			continue;
+
+		std::cout << i << ":";
+
+		for (int j = 0; j < BUCKET_SLOTS; j++)
+		{
+			if (buckets_[i].isUsed(j))
+				std::cout << " { " << buckets_[i].slots[j].key << ", " << buckets_[i].slots[j].value << " }";
+		}
+
+		std::cout << "\n";
+	}
+}
+
+#endif
@@ -2,139 +2,415 @@
 #define CLOSED_ADDRESSING_TABLE_HPP
 
 #include "HashTable.hpp"
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
 #include "SinglyLinkedList.hpp"
+#include "UnrolledBucket.hpp"
+#include "HybridBucket.hpp"
+#include "Prefetch.hpp"
 
 #include <vector>
 #include <functional>
-#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
 
-template <typename T1, typename T2>
+#define BUILD_STEP 64	// Number of buckets of the next array constructed by every operation
+#define REHASH_STEP 4	// Number of old buckets moved into the new array by every operation
+
+// Bucket is the chain type: HybridBucket, a linked chain that turns into an AVL tree when it gets long,
+// SinglyLinkedList with one entry per node, or UnrolledBucket with cache line sized blocks of entries.
+// A resizing table grows when the load factor would pass the maximum and shrinks when it drops below
+// an eighth of it. A resize never does O(n) work in one operation. First the next bucket array is
+// constructed, BUILD_STEP buckets per insert or remove, while the current one keeps serving. Then it
+// becomes the current array, the old one is kept next to it and every operation moves REHASH_STEP
+// buckets from its end and destroys them, until the old array is empty
+template <typename T1, typename T2, typename Hash = Hasher<T1>, typename Range = ModuloRange, typename Bucket = HybridBucket<T1, T2>>
 class ClosedAddressingTable : public HashTable<T1, T2>
 {
 private:
-	// Type definition for key - value buckets
-	typedef SinglyLinkedList<T1, T2> Bucket;
+	// Chain nodes of every bucket, declared first so it outlives the buckets
+	typename Bucket::Pool nodePool_;
 
 	std::vector<Bucket> bucketArray_;
-	size_t size_;
+	std::vector<Bucket> oldBuckets_;	// Buckets not moved yet, empty if no migration is in progress
+	std::vector<Bucket> nextBuckets_;	// Array being constructed, empty if no resize is pending
+
+	size_t size_;		// Number of buckets
+	size_t nextSize_;	// Number of buckets of the next array, 0 if no resize is pending
+	size_t oldSize_;	// Number of buckets the old array started with, 0 if no migration is in progress
+	size_t minSize_;	// The table never shrinks below its initial size
 	size_t elements_;
 	float loadFactor_;
+	float maxLoadFactor_;
+	bool pooled_;
+	bool autoResize_;
 
-	size_t hash(int key, int type = 0);
-	size_t hash(float key, int type = 0);
-	size_t hash(char key, int type = 0);
-	size_t hash(std::string key, int type = 0);
+	template <typename K>
+	uint64_t hash(const K& key);
+	template <typename K>
+	T2* lookup(const K& key, uint64_t hashValue);
+	template <typename K>
+	bool erase(const K& key, uint64_t hashValue);
+	void insertHashed(T1&& key, T2&& value, uint64_t hashValue);
+	template <typename Operation>
+	void forEachBatch(const T1* keys, size_t count, Operation operation);
+	void allocateBuckets(size_t size);
+	void startResize(size_t size);
+	void build(size_t steps);
+	void migrate(size_t steps);
+	void step();
 
 public:
-	ClosedAddressingTable(size_t size);
-	ClosedAddressingTable(const ClosedAddressingTable<T1, T2>& copy);
+	ClosedAddressingTable(size_t size, bool pooled = true, bool autoResize = true, float maxLoadFactor = 1.0f);
+	ClosedAddressingTable(const ClosedAddressingTable<T1, T2, Hash, Range, Bucket>& copy);
 	~ClosedAddressingTable();
 
 	void insert(T1 key, T2 value) override;
 	void remove(T1 key) override;
+	T2* find(const T1& key) override;
+	bool tryRemove(const T1& key) override;
 	void display();
 
-	size_t calculateLoadFactor();
+	void findBatch(const T1* keys, size_t count, T2** values) override;
+	void insertBatch(const T1* keys, const T2* values, size_t count) override;
+	size_t removeBatch(const T1* keys, size_t count) override;
+
+	// Lookups with any key type a transparent hasher accepts, e.g. std::string_view for std::string keys
+	using HashTable<T1, T2>::contains;
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	T2* find(const K& key) { return lookup(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const K& key) { return lookup(key, hash(key)) != nullptr; }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool tryRemove(const K& key) { return erase(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	void remove(const K& key);
+
+	float calculateLoadFactor();
 };
 
-// Initialize empty table of specified size
-template <typename T1, typename T2>
-ClosedAddressingTable<T1, T2>::ClosedAddressingTable(size_t size) : size_(size), bucketArray_(size), elements_(0), loadFactor_(0.0)
+// Initialize empty table of specified size, as rounded by the range policy.
+// Pooled tables take chain nodes from a slab arena owned by the table instead of one new per node
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::ClosedAddressingTable(size_t size, bool pooled, bool autoResize, float maxLoadFactor)
+	: size_(Range::capacity(size)), nextSize_(0), oldSize_(0), minSize_(size_), elements_(0), loadFactor_(0.0), maxLoadFactor_(maxLoadFactor), pooled_(pooled), autoResize_(autoResize)
+{
+	if (size == 0)
+		throw std::invalid_argument("Table size must be positive");
+
+	if (maxLoadFactor <= 0.0f)
+		throw std::invalid_argument("Maximum load factor must be positive");
+
+	allocateBuckets(size_);
+}
+
+// Copy constructor, every chain is rebuilt with nodes of the new table. A resize in progress is finished in the copy
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::ClosedAddressingTable(const ClosedAddressingTable<T1, T2, Hash, Range, Bucket>& copy)
+	: size_(copy.size_), nextSize_(0), oldSize_(0), minSize_(copy.minSize_), elements_(copy.elements_), loadFactor_(copy.loadFactor_), maxLoadFactor_(copy.maxLoadFactor_), pooled_(copy.pooled_), autoResize_(copy.autoResize_)
+{
+	allocateBuckets(size_);
+
+	for (size_t i = 0; i < size_; i++)
+	{
+		Bucket& bucket = bucketArray_[i];
+		copy.bucketArray_[i].forEach([this, &bucket](const T1& key, const T2& value) { bucket.pushBack(key, value, hash(key)); });
+	}
+
+	for (size_t i = 0; i < copy.oldBuckets_.size(); i++)
+		copy.oldBuckets_[i].forEach([this](const T1& key, const T2& value)
+		{
+			uint64_t hashValue = hash(key);
+			bucketArray_[Range::reduce(hashValue, size_)].pushBack(key, value, hashValue);
+		});
+}
+
+// Pooled chains are dropped without freeing node by node, the pool then frees its slabs in bulk
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::~ClosedAddressingTable()
+{
+	if (pooled_)
+	{
+		for (size_t i = 0; i < bucketArray_.size(); i++)
+			bucketArray_[i].release();
+
+		for (size_t i = 0; i < oldBuckets_.size(); i++)
+			oldBuckets_[i].release();
+	}
+}
+
+// Hash the key. The range policy reduces the hash to an index in a bucket array, and buckets store it
+// with keys that are not scalars so that chains compare full keys only when the hashes match
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+template <typename K>
+uint64_t ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::hash(const K& key)
 {
-	// In progress
+	Hash hashFunction;
+
+	return hashFunction(key);
 }
 
-// Copy constructor
-template <typename T1, typename T2>
-ClosedAddressingTable<T1, T2>::ClosedAddressingTable(const ClosedAddressingTable<T1, T2>& copy)
+// Fill the bucket array with empty buckets
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::allocateBuckets(size_t size)
 {
-	bucketArray_ = copy.bucketArray_;
-	size_ = copy.size_;
+	bucketArray_.clear();
+	bucketArray_.reserve(size);
+
+	for (size_t i = 0; i < size; i++)
+		bucketArray_.emplace_back(pooled_ ? &nodePool_ : nullptr);
 }
 
-template <typename T1, typename T2>
-ClosedAddressingTable<T1, T2>::~ClosedAddressingTable()
+// Reserve the next bucket array. Nothing is constructed yet, that is left to the following operations
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::startResize(size_t size)
 {
-	// In progress
+	nextSize_ = Range::capacity(size);
+	nextBuckets_.reserve(nextSize_);
 }
 
-// Simple division based hash function
-template <typename T1, typename T2>
-size_t ClosedAddressingTable<T1, T2>::hash(int key, int type = 0)
+// Construct a number of buckets of the next array. Once it is complete it becomes the current array
+// and the current one becomes the old array, whose buckets are moved by the following operations
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::build(size_t steps)
 {
-	size_t hashValue = key % size_;
+	while (steps > 0 && nextBuckets_.size() < nextSize_)
+	{
+		nextBuckets_.emplace_back(pooled_ ? &nodePool_ : nullptr);
+		steps--;
+	}
+
+	if (nextBuckets_.size() == nextSize_)
+	{
+		oldBuckets_.swap(bucketArray_);
+		bucketArray_.swap(nextBuckets_);
 
-	return hashValue;
+		oldSize_ = size_;
+		size_ = nextSize_;
+		nextSize_ = 0;
+	}
 }
 
-// hashing function using std::hash
-template <typename T1, typename T2>
-size_t ClosedAddressingTable<T1, T2>::hash(float key, int type = 0)
+// Move a number of buckets from the end of the old array into the new one. Removing them from the end
+// keeps every step cheap, the emptied array is freed without running through it again
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::migrate(size_t steps)
 {
-	std::hash<float> hashFunction;
-	size_t hashValue = hashFunction(key);
+	if (oldSize_ == 0)
+		return;
+
+	while (steps > 0 && !oldBuckets_.empty())
+	{
+		// Entries are moved with the hashes they store, keys are hashed again only if they store none
+		oldBuckets_.back().drain([this](T1&& key, T2&& value, const StoredHash<T1>& stored)
+		{
+			uint64_t hashValue = stored.getHash(key, Hash());
+			bucketArray_[Range::reduce(hashValue, size_)].pushBack(std::move(key), std::move(value), hashValue);
+		});
+		oldBuckets_.pop_back();
+
+		steps--;
+	}
 
-	return hashValue;
+	if (oldBuckets_.empty())
+	{
+		std::vector<Bucket>().swap(oldBuckets_);
+		oldSize_ = 0;
+	}
 }
 
-// Simple division based hash function
-template <typename T1, typename T2>
-size_t ClosedAddressingTable<T1, T2>::hash(char key, int type = 0)
+// Do the share of a pending resize that falls on one operation
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::step()
 {
-	char asciiValue = int(key);
-	size_t hashValue = (asciiValue) % size_;
+	if (nextSize_ != 0)
+		build(BUILD_STEP);
+	else
+		migrate(REHASH_STEP);
+}
 
-	return hashValue;
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+T2* ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::find(const T1& key)
+{
+	return lookup(key, hash(key));
 }
-// Division based hash function
-template <typename T1, typename T2>
-size_t ClosedAddressingTable<T1, T2>::hash(std::string key, int type = 0)
+
+// Return a pointer to the value stored with the key, or nullptr.
+// Old buckets that were not moved yet still hold their keys
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+template <typename K>
+T2* ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::lookup(const K& key, uint64_t hashValue)
 {
-	int sum = 0;
+	T2* value = bucketArray_[Range::reduce(hashValue, size_)].findValue(key, hashValue);
 
-	// To get an integer value, we multiply every character of string by a large prime number
-	for (int i = 0; i < key.size(); i++)
-		sum += int(key[i]) * pow(31, i);
+	if (value == nullptr && oldSize_ != 0)
+	{
+		size_t oldIndex = Range::reduce(hashValue, oldSize_);
 
-	size_t hashValue = sum % size_;
+		if (oldIndex < oldBuckets_.size())
+			value = oldBuckets_[oldIndex].findValue(key, hashValue);
+	}
+
+	return value;
+}
+
+// Insert key-value pair at a calculated index and handle colission if it occurs.
+// Starts a resize if the element would push the load factor past the maximum. The load factor
+// can pass it for a while, until the resize that is already in progress is finished
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::insert(T1 key, T2 value)
+{
+	uint64_t hashValue = hash(key);
 
-	return hashValue;
+	insertHashed(std::move(key), std::move(value), hashValue);
 }
 
-// Insert key-value pair at a calculated index and handle colission if it occurs
-template <typename T1, typename T2>
-void ClosedAddressingTable<T1, T2>::insert(T1 key, T2 value)
+// Insert a key-value pair whose key is hashed already, see insert
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::insertHashed(T1&& key, T2&& value, uint64_t hashValue)
 {
-	int index = hash(key);
-	bucketArray_[index].pushBack(key, value);
+	step();
+
+	// If key is already present, do not insert
+	if (lookup(key, hashValue) != nullptr)
+		return;
+
+	if (autoResize_ && nextSize_ == 0 && oldSize_ == 0 && elements_ + 1 > maxLoadFactor_ * size_)
+		startResize(size_ * 2);
+
+	size_t index = Range::reduce(hashValue, size_);
+	bucketArray_[index].pushBack(std::move(key), std::move(value), hashValue);
 
 	elements_++;
 }
 
-// Find element with specified key and remove it
-template <typename T1, typename T2>
-void ClosedAddressingTable<T1, T2>::remove(T1 key)
+// Remove element with specified key, nothing happens if it is not there
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::remove(T1 key)
+{
+	tryRemove(key);
+}
+
+// Remove element with a key of a compatible type, nothing happens if it is not there
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+template <typename K, typename H, typename>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::remove(const K& key)
+{
+	erase(key, hash(key));
+}
+
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+bool ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::tryRemove(const T1& key)
+{
+	return erase(key, hash(key));
+}
+
+// Find element with specified key and remove it in a single walk of its chain.
+// The key may still be in the old array if a resize is in progress
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+template <typename K>
+bool ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::erase(const K& key, uint64_t hashValue)
+{
+	step();
+
+	bool found = bucketArray_[Range::reduce(hashValue, size_)].erase(key, hashValue);
+
+	// Old buckets that were not moved yet still hold their keys
+	if (!found && oldSize_ != 0)
+	{
+		size_t oldIndex = Range::reduce(hashValue, oldSize_);
+		found = oldIndex < oldBuckets_.size() && oldBuckets_[oldIndex].erase(key, hashValue);
+	}
+
+	if (!found)
+		return false;
+
+	elements_--;
+
+	if (autoResize_ && nextSize_ == 0 && oldSize_ == 0 && size_ > minSize_ && elements_ < maxLoadFactor_ * size_ / 8)
+		startResize(size_ / 2 > minSize_ ? size_ / 2 : minSize_);
+
+	return true;
+}
+
+// Call operation(i, hashValue) for every key, a batch of keys at a time. The buckets of a batch are
+// prefetched first, then the first node of every chain, which only a loaded bucket can point to, and
+// only then is the first key of the batch resolved
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+template <typename Operation>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::forEachBatch(const T1* keys, size_t count, Operation operation)
+{
+	uint64_t hashes[PREFETCH_BATCH];
+
+	for (size_t start = 0; start < count; start += PREFETCH_BATCH)
+	{
+		size_t batch = count - start < PREFETCH_BATCH ? count - start : PREFETCH_BATCH;
+
+		for (size_t i = 0; i < batch; i++)
+		{
+			hashes[i] = hash(keys[start + i]);
+			prefetchLine(&bucketArray_[Range::reduce(hashes[i], size_)]);
+		}
+
+		for (size_t i = 0; i < batch; i++)
+			bucketArray_[Range::reduce(hashes[i], size_)].prefetch();
+
+		for (size_t i = 0; i < batch; i++)
+			operation(start + i, hashes[i]);
+	}
+}
+
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::findBatch(const T1* keys, size_t count, T2** values)
+{
+	forEachBatch(keys, count, [this, keys, values](size_t i, uint64_t hashValue) { values[i] = lookup(keys[i], hashValue); });
+}
+
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::insertBatch(const T1* keys, const T2* values, size_t count)
+{
+	forEachBatch(keys, count, [this, keys, values](size_t i, uint64_t hashValue) { insertHashed(T1(keys[i]), T2(values[i]), hashValue); });
+}
+
+// Remove every key of the array that is there, return the number of keys removed
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+size_t ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::removeBatch(const T1* keys, size_t count)
 {
-	int index = hash(key);
-	int pairToRemove = bucketArray_[index].find(key);
+	size_t removed = 0;
 
-	bucketArray_[index].remove(pairToRemove);
+	forEachBatch(keys, count, [this, keys, &removed](size_t i, uint64_t hashValue)
+	{
+		if (erase(keys[i], hashValue))
+			removed++;
+	});
+
+	return removed;
 }
 
-template <typename T1, typename T2>
-size_t ClosedAddressingTable<T1, T2>::calculateLoadFactor()
+// Ratio of elements to buckets of the current array, which holds every element once a resize is finished
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+float ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::calculateLoadFactor()
 {
-	loadFactor_ = elements_ / size_;
+	loadFactor_ = static_cast<float>(elements_) / size_;
+
+	return loadFactor_;
 }
 
-// Display every bucket
-template <typename T1, typename T2>
-void ClosedAddressingTable<T1, T2>::display()
+// Display every bucket, then the buckets still waiting to be moved
+template <typename T1, typename T2, typename Hash, typename Range, typename Bucket>
+void ClosedAddressingTable<T1, T2, Hash, Range, Bucket>::display()
 {
-	for (int i = 0; i < size_; i++)
+	for (size_t i = 0; i < size_; i++)
 	{
 		if(!bucketArray_[i].isEmpty())
 			bucketArray_[i].show();
 	}
+
+	for (size_t i = 0; i < oldBuckets_.size(); i++)
+	{
+		if (!oldBuckets_[i].isEmpty())
+			oldBuckets_[i].show();
+	}
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,637 @@
+#ifndef CONCURRENT_CUCKOO_TABLE_HPP
+#define CONCURRENT_CUCKOO_TABLE_HPP
+
+#define CONCURRENT_BUCKET_SLOTS 4	// Number of slots in a bucket
+#define VERSION_STRIPES 2048		// Number of version counters the buckets are spread over
+#define MAX_PATH_BUCKETS 256		// Number of buckets visited while looking for a cuckoo path before growing
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
+
+// Concurrent cuckoo table in the style of libcuckoo, for trivially copyable keys and values of up to 64 bits.
+// Every key has two candidate buckets of CONCURRENT_BUCKET_SLOTS slots, and every bucket is guarded by one of
+// VERSION_STRIPES version counters that doubles as a spin lock: a writer makes it odd while it changes
+// a bucket and even again, two higher, when it is done.
+//  - readers take no lock: they read the versions of both buckets, the slots, and the versions again, and
+//    retry if a writer got in between. Slots are atomic words, so a torn read is discarded, never undefined
+//  - inserts, assignments and removals lock the stripes of the two candidate buckets, in index order
+//  - when both buckets are full, a breadth-first search finds a cuckoo path without locking anything.
+//    The keys are then moved back to front, each move locking only its two buckets and checking that the
+//    path is still valid, otherwise the insert starts over
+//  - growing locks every stripe and publishes a bucket array twice as big. Readers still on the old array
+//    notice the new one when they validate. Old arrays are kept until the table is destroyed, which costs at
+//    most the size of the current array
+// The all ones 64 bit pattern marks an empty slot and cannot be stored as a 64 bit key
+template <typename T1, typename T2, typename Hash = Hasher<T1>>
+class ConcurrentCuckooTable
+{
+private:
+	static_assert(std::is_trivially_copyable<T1>::value && sizeof(T1) <= 8, "Keys must be trivially copyable and at most 64 bits");
+	static_assert(std::is_trivially_copyable<T2>::value && sizeof(T2) <= 8, "Values must be trivially copyable and at most 64 bits");
+
+	static constexpr uint64_t EMPTY_KEY = ~uint64_t(0);
+
+	struct Bucket
+	{
+		std::atomic<uint64_t> keys[CONCURRENT_BUCKET_SLOTS];
+		std::atomic<uint64_t> values[CONCURRENT_BUCKET_SLOTS];
+
+		Bucket();
+	};
+
+	struct BucketArray
+	{
+		std::unique_ptr<Bucket[]> buckets;
+		size_t size;		// Number of buckets, a power of two
+
+		BucketArray(size_t size) : buckets(new Bucket[size]), size(size) {}
+	};
+
+	// Version counter and lock of the buckets mapped to a stripe, with the number of keys they hold
+	struct alignas(64) Stripe
+	{
+		std::atomic<uint64_t> version{ 0 };
+		std::atomic<long long> elements{ 0 };
+	};
+
+	// A step of the breadth-first search: the key in slot of the parent bucket can move into this bucket
+	struct PathStep
+	{
+		size_t bucket;
+		int parent;
+		int slot;
+		uint64_t key;
+	};
+
+	std::atomic<BucketArray*> array_;
+	std::vector<std::unique_ptr<BucketArray>> arrays_;	// Every array ever published, the last one is current
+	std::unique_ptr<Stripe[]> stripes_;
+
+	template <typename T>
+	static uint64_t encode(const T& item);
+	template <typename T>
+	static T decode(uint64_t word);
+
+	static uint64_t hash(const T1& key);
+	static size_t index(uint64_t hashValue, int type, size_t size);
+	static size_t alternate(uint64_t keyWord, size_t bucket, size_t size);
+	static int findSlot(const Bucket& bucket, uint64_t keyWord);
+	static int findFreeSlot(const Bucket& bucket);
+
+	Stripe& stripeOf(size_t bucket) const;
+	void lock(Stripe& stripe);
+	void unlock(Stripe& stripe);
+	BucketArray* lockBuckets(uint64_t hashValue, size_t& bucket1, size_t& bucket2);
+	void unlockBuckets(size_t bucket1, size_t bucket2);
+
+	bool findPath(const BucketArray& array, size_t bucket1, size_t bucket2, std::vector<PathStep>& path);
+	bool movePath(BucketArray* array, const std::vector<PathStep>& path);
+	void grow(BucketArray* full);
+	static bool place(BucketArray& array, uint64_t keyWord, uint64_t valueWord, std::mt19937& generator);
+
+	template <typename Write>
+	bool write(const T1& key, const T2& value, Write onExisting);
+
+	ConcurrentCuckooTable(const ConcurrentCuckooTable&) = delete;
+	ConcurrentCuckooTable& operator=(const ConcurrentCuckooTable&) = delete;
+
+public:
+	ConcurrentCuckooTable(size_t capacity);
+
+	bool insert(const T1& key, const T2& value);
+	void insertOrAssign(const T1& key, const T2& value);
+	bool find(const T1& key, T2& value) const;
+	bool contains(const T1& key) const;
+	bool tryRemove(const T1& key);
+
+	size_t getSize() const;
+	size_t getCapacity() const;
+};
+
+template <typename T1, typename T2, typename Hash>
+ConcurrentCuckooTable<T1, T2, Hash>::Bucket::Bucket()
+{
+	for (int i = 0; i < CONCURRENT_BUCKET_SLOTS; i++)
+	{
+		keys[i].store(EMPTY_KEY, std::memory_order_relaxed);
+		values[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+// Allocate enough buckets for the specified number of elements, rounded up to a power of two
+template <typename T1, typename T2, typename Hash>
+ConcurrentCuckooTable<T1, T2, Hash>::ConcurrentCuckooTable(size_t capacity) : stripes_(new Stripe[VERSION_STRIPES])
+{
+	arrays_.emplace_back(new BucketArray(PowerOfTwoRange::capacity((capacity + CONCURRENT_BUCKET_SLOTS - 1) / CONCURRENT_BUCKET_SLOTS)));
+	array_.store(arrays_.back().get(), std::memory_order_release);
+}
+
+// Copy the bits of a key or value into the low bytes of a word
+template <typename T1, typename T2, typename Hash>
+template <typename T>
+uint64_t ConcurrentCuckooTable<T1, T2, Hash>::encode(const T& item)
+{
+	uint64_t word = 0;
+	std::memcpy(&word, &item, sizeof(T));
+	return word;
+}
+
+template <typename T1, typename T2, typename Hash>
+template <typename T>
+T ConcurrentCuckooTable<T1, T2, Hash>::decode(uint64_t word)
+{
+	T item;
+	std::memcpy(&item, &word, sizeof(T));
+	return item;
+}
+
+template <typename T1, typename T2, typename Hash>
+uint64_t ConcurrentCuckooTable<T1, T2, Hash>::hash(const T1& key)
+{
+	Hash hashFunction;
+
+	return hashFunction(key);
+}
+
+// Calculate a candidate bucket from the hash of a key, type selects the first or the second one
+template <typename T1, typename T2, typename Hash>
+size_t ConcurrentCuckooTable<T1, T2, Hash>::index(uint64_t hashValue, int type, size_t size)
+{
+	return PowerOfTwoRange::reduce(type == 0 ? hashValue : hashing::mix(hashValue ^ 0x9e3779b97f4a7c15ULL), size);
+}
+
+// Get the other candidate bucket of a key stored in the specified bucket
+template <typename T1, typename T2, typename Hash>
+size_t ConcurrentCuckooTable<T1, T2, Hash>::alternate(uint64_t keyWord, size_t bucket, size_t size)
+{
+	uint64_t hashValue = hash(decode<T1>(keyWord));
+	size_t bucket1 = index(hashValue, 0, size);
+
+	return bucket == bucket1 ? index(hashValue, 1, size) : bucket1;
+}
+
+// Return the slot of the bucket holding the key, or -1
+template <typename T1, typename T2, typename Hash>
+int ConcurrentCuckooTable<T1, T2, Hash>::findSlot(const Bucket& bucket, uint64_t keyWord)
+{
+	for (int i = 0; i < CONCURRENT_BUCKET_SLOTS; i++)
+	{
+		if (bucket.keys[i].load(std::memory_order_relaxed) == keyWord)
+			return i;
+	}
+
+	return -1;
+}
+
+// Return an empty slot of the bucket, or -1
+template <typename T1, typename T2, typename Hash>
+int ConcurrentCuckooTable<T1, T2, Hash>::findFreeSlot(const Bucket& bucket)
+{
+	return findSlot(bucket, EMPTY_KEY);
+}
+
+template <typename T1, typename T2, typename Hash>
+typename ConcurrentCuckooTable<T1, T2, Hash>::Stripe& ConcurrentCuckooTable<T1, T2, Hash>::stripeOf(size_t bucket) const
+{
+	return stripes_[bucket & (VERSION_STRIPES - 1)];
+}
+
+// Spin until the version is even and make it odd. The fence keeps the slot writes that follow after it
+template <typename T1, typename T2, typename Hash>
+void ConcurrentCuckooTable<T1, T2, Hash>::lock(Stripe& stripe)
+{
+	while (true)
+	{
+		uint64_t version = stripe.version.load(std::memory_order_relaxed);
+
+		if (version % 2 == 0 && stripe.version.compare_exchange_weak(version, version + 1, std::memory_order_acquire, std::memory_order_relaxed))
+			break;
+
+		std::this_thread::yield();
+	}
+
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Make the version even again, readers that overlapped the write see it changed
+template <typename T1, typename T2, typename Hash>
+void ConcurrentCuckooTable<T1, T2, Hash>::unlock(Stripe& stripe)
+{
+	stripe.version.store(stripe.version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Lock the stripes of both candidate buckets of a hash in the current array, which is returned.
+// Stripes are locked in index order so that two writers never wait for each other in a cycle
+template <typename T1, typename T2, typename Hash>
+typename ConcurrentCuckooTable<T1, T2, Hash>::BucketArray* ConcurrentCuckooTable<T1, T2, Hash>::lockBuckets(uint64_t hashValue, size_t& bucket1, size_t& bucket2)
+{
+	while (true)
+	{
+		BucketArray* array = array_.load(std::memory_order_acquire);
+		bucket1 = index(hashValue, 0, array->size);
+		bucket2 = index(hashValue, 1, array->size);
+
+		size_t stripe1 = bucket1 & (VERSION_STRIPES - 1);
+		size_t stripe2 = bucket2 & (VERSION_STRIPES - 1);
+
+		lock(stripes_[stripe1 < stripe2 ? stripe1 : stripe2]);
+		if (stripe1 != stripe2)
+			lock(stripes_[stripe1 < stripe2 ? stripe2 : stripe1]);
+
+		// A table that grew in the meantime maps the key to other buckets
+		if (array_.load(std::memory_order_acquire) == array)
+			return array;
+
+		unlockBuckets(bucket1, bucket2);
+	}
+}
+
+template <typename T1, typename T2, typename Hash>
+void ConcurrentCuckooTable<T1, T2, Hash>::unlockBuckets(size_t bucket1, size_t bucket2)
+{
+	if ((bucket1 & (VERSION_STRIPES - 1)) != (bucket2 & (VERSION_STRIPES - 1)))
+		unlock(stripeOf(bucket2));
+
+	unlock(stripeOf(bucket1));
+}
+
+// Breadth-first search from both candidate buckets for the closest bucket with a free slot, reading the
+// slots without locks. The path may be stale by the time it is used, movePath checks every step again
+template <typename T1, typename T2, typename Hash>
+bool ConcurrentCuckooTable<T1, T2, Hash>::findPath(const BucketArray& array, size_t bucket1, size_t bucket2, std::vector<PathStep>& path)
+{
+	path.clear();
+	path.push_back({ bucket1, -1, -1, EMPTY_KEY });
+
+	if (bucket2 != bucket1)
+		path.push_back({ bucket2, -1, -1, EMPTY_KEY });
+
+	for (size_t head = 0; head < path.size() && path.size() < MAX_PATH_BUCKETS; head++)
+	{
+		size_t bucket = path[head].bucket;
+
+		for (int i = 0; i < CONCURRENT_BUCKET_SLOTS; i++)
+		{
+			uint64_t keyWord = array.buckets[bucket].keys[i].load(std::memory_order_relaxed);
+
+			// The slot was freed since the bucket was found full, the path ends here
+			if (keyWord == EMPTY_KEY)
+			{
+				path.resize(head + 1);
+				return true;
+			}
+
+			size_t next = alternate(keyWord, bucket, array.size);
+			bool visited = false;
+
+			for (const PathStep& step : path)
+				visited = visited || step.bucket == next;
+
+			if (visited)
+				continue;
+
+			path.push_back({ next, static_cast<int>(head), i, keyWord });
+
+			if (findFreeSlot(array.buckets[next]) != -1)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+// Move the keys of a path back to front, each into the free slot of the next bucket. Every move locks
+// its two buckets and checks the key and the free slot are still there. Returns false if one was not
+template <typename T1, typename T2, typename Hash>
+bool ConcurrentCuckooTable<T1, T2, Hash>::movePath(BucketArray* array, const std::vector<PathStep>& path)
+{
+	int step = static_cast<int>(path.size()) - 1;
+
+	while (path[step].parent != -1)
+	{
+		size_t from = path[path[step].parent].bucket;
+		size_t to = path[step].bucket;
+		size_t stripe1 = from & (VERSION_STRIPES - 1);
+		size_t stripe2 = to & (VERSION_STRIPES - 1);
+
+		lock(stripes_[stripe1 < stripe2 ? stripe1 : stripe2]);
+		if (stripe1 != stripe2)
+			lock(stripes_[stripe1 < stripe2 ? stripe2 : stripe1]);
+
+		Bucket& source = array->buckets[from];
+		Bucket& target = array->buckets[to];
+		int slot = path[step].slot;
+		int free = findFreeSlot(target);
+		bool valid = array_.load(std::memory_order_relaxed) == array && free != -1 && source.keys[slot].load(std::memory_order_relaxed) == path[step].key;
+
+		if (valid)
+		{
+			target.values[free].store(source.values[slot].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			target.keys[free].store(path[step].key, std::memory_order_relaxed);
+			source.keys[slot].store(EMPTY_KEY, std::memory_order_relaxed);
+
+			if (stripe1 != stripe2)
+			{
+				stripes_[stripe1].elements.fetch_sub(1, std::memory_order_relaxed);
+				stripes_[stripe2].elements.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		unlockBuckets(from, to);
+
+		if (!valid)
+			return false;
+
+		step = path[step].parent;
+	}
+
+	return true;
+}
+
+// Put a key into an array no other thread can see yet, evicting keys on a random walk. Returns false if
+// the walk got too long, the key left without a slot is lost and the caller starts over with more buckets
+template <typename T1, typename T2, typename Hash>
+bool ConcurrentCuckooTable<T1, T2, Hash>::place(BucketArray& array, uint64_t keyWord, uint64_t valueWord, std::mt19937& generator)
+{
+	uint64_t hashValue = hash(decode<T1>(keyWord));
+	size_t bucket = index(hashValue, 0, array.size);
+
+	for (int evictions = 0; evictions < MAX_PATH_BUCKETS; evictions++)
+	{
+		int free = findFreeSlot(array.buckets[bucket]);
+
+		if (free == -1)
+		{
+			size_t other = alternate(keyWord, bucket, array.size);
+			free = findFreeSlot(array.buckets[other]);
+			bucket = other;
+		}
+
+		if (free != -1)
+		{
+			array.buckets[bucket].keys[free].store(keyWord, std::memory_order_relaxed);
+			array.buckets[bucket].values[free].store(valueWord, std::memory_order_relaxed);
+			return true;
+		}
+
+		// Swap with a random key of the bucket and carry that one to its other bucket
+		int victim = static_cast<int>(generator() % CONCURRENT_BUCKET_SLOTS);
+		uint64_t evictedKey = array.buckets[bucket].keys[victim].load(std::memory_order_relaxed);
+		uint64_t evictedValue = array.buckets[bucket].values[victim].load(std::memory_order_relaxed);
+
+		array.buckets[bucket].keys[victim].store(keyWord, std::memory_order_relaxed);
+		array.buckets[bucket].values[victim].store(valueWord, std::memory_order_relaxed);
+
+		keyWord = evictedKey;
+		valueWord = evictedValue;
+		bucket = alternate(keyWord, bucket, array.size);
+	}
+
+	return false;
+}
+
+// Lock every stripe and replace the array with one at least twice as big, unless another thread already
+// replaced the full one
+template <typename T1, typename T2, typename Hash>
+void ConcurrentCuckooTable<T1, T2, Hash>::grow(BucketArray* full)
+{
+	for (size_t i = 0; i < VERSION_STRIPES; i++)
+		lock(stripes_[i]);
+
+	BucketArray* current = array_.load(std::memory_order_relaxed);
+
+	if (current == full)
+	{
+		std::mt19937 generator(static_cast<unsigned>(current->size));
+		size_t size = current->size * 2;
+		std::unique_ptr<BucketArray> bigger;
+		bool placed = false;
+
+		while (!placed)
+		{
+			bigger.reset(new BucketArray(size));
+			placed = true;
+
+			for (size_t bucket = 0; bucket < current->size && placed; bucket++)
+			{
+				for (int i = 0; i < CONCURRENT_BUCKET_SLOTS && placed; i++)
+				{
+					uint64_t keyWord = current->buckets[bucket].keys[i].load(std::memory_order_relaxed);
+
+					if (keyWord != EMPTY_KEY)
+						placed = place(*bigger, keyWord, current->buckets[bucket].values[i].load(std::memory_order_relaxed), generator);
+				}
+			}
+
+			size *= 2;
+		}
+
+		// Keys moved to other buckets, so the element counts of the stripes start over
+		for (size_t i = 0; i < VERSION_STRIPES; i++)
+			stripes_[i].elements.store(0, std::memory_order_relaxed);
+
+		for (size_t bucket = 0; bucket < bigger->size; bucket++)
+		{
+			for (int i = 0; i < CONCURRENT_BUCKET_SLOTS; i++)
+			{
+				if (bigger->buckets[bucket].keys[i].load(std::memory_order_relaxed) != EMPTY_KEY)
+					stripeOf(bucket).elements.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		arrays_.push_back(std::move(bigger));
+		array_.store(arrays_.back().get(), std::memory_order_release);
+	}
+
+	for (size_t i = VERSION_STRIPES; i > 0; i--)
+		unlock(stripes_[i - 1]);
+}
+
+// Store the pair in a free slot of one of its buckets, making room along a cuckoo path if both are full.
+// If the key is already there, onExisting(valueSlot) decides what happens and its result is returned
+template <typename T1, typename T2, typename Hash>
+template <typename Write>
+bool ConcurrentCuckooTable<T1, T2, Hash>::write(const T1& key, const T2& value, Write onExisting)
+{
+	uint64_t keyWord = encode(key);
+	uint64_t valueWord = encode(value);
+	uint64_t hashValue = hash(key);
+	std::vector<PathStep> path;
+
+	if (keyWord == EMPTY_KEY)
+		throw std::invalid_argument("The all ones 64 bit pattern is reserved");
+
+	while (true)
+	{
+		size_t bucket1, bucket2;
+		BucketArray* array = lockBuckets(hashValue, bucket1, bucket2);
+		Bucket* buckets[2] = { &array->buckets[bucket1], &array->buckets[bucket2] };
+		size_t indexes[2] = { bucket1, bucket2 };
+
+		for (int b = 0; b < 2; b++)
+		{
+			int slot = findSlot(*buckets[b], keyWord);
+
+			if (slot != -1)
+			{
+				bool result = onExisting(buckets[b]->values[slot], valueWord);
+				unlockBuckets(bucket1, bucket2);
+				return result;
+			}
+		}
+
+		for (int b = 0; b < 2; b++)
+		{
+			int slot = findFreeSlot(*buckets[b]);
+
+			if (slot != -1)
+			{
+				buckets[b]->values[slot].store(valueWord, std::memory_order_relaxed);
+				buckets[b]->keys[slot].store(keyWord, std::memory_order_relaxed);
+				stripeOf(indexes[b]).elements.fetch_add(1, std::memory_order_relaxed);
+				unlockBuckets(bucket1, bucket2);
+				return true;
+			}
+		}
+
+		unlockBuckets(bucket1, bucket2);
+
+		// Both buckets are full: make room along a cuckoo path, or grow if there is none, and start over
+		if (!findPath(*array, bucket1, bucket2, path))
+			grow(array);
+		else
+			movePath(array, path);
+	}
+}
+
+// Insert the pair if the key is not there, return whether it was inserted
+template <typename T1, typename T2, typename Hash>
+bool ConcurrentCuckooTable<T1, T2, Hash>::insert(const T1& key, const T2& value)
+{
+	return write(key, value, [](std::atomic<uint64_t>&, uint64_t) { return false; });
+}
+
+// Store the value with the key, whether or not the key was there
+template <typename T1, typename T2, typename Hash>
+void ConcurrentCuckooTable<T1, T2, Hash>::insertOrAssign(const T1& key, const T2& value)
+{
+	write(key, value, [](std::atomic<uint64_t>& slot, uint64_t valueWord) { slot.store(valueWord, std::memory_order_relaxed); return false; });
+}
+
+// Copy the value of the key into value, return false if the key is not there. Takes no lock: the read is
+// repeated until no writer changed either bucket, or the array, while it ran
+template <typename T1, typename T2, typename Hash>
+bool ConcurrentCuckooTable<T1, T2, Hash>::find(const T1& key, T2& value) const
+{
+	uint64_t keyWord = encode(key);
+	uint64_t hashValue = hash(key);
+
+	while (true)
+	{
+		BucketArray* array = array_.load(std::memory_order_acquire);
+		size_t bucket1 = index(hashValue, 0, array->size);
+		size_t bucket2 = index(hashValue, 1, array->size);
+		Stripe& stripe1 = stripeOf(bucket1);
+		Stripe& stripe2 = stripeOf(bucket2);
+
+		uint64_t version1 = stripe1.version.load(std::memory_order_acquire);
+		uint64_t version2 = stripe2.version.load(std::memory_order_acquire);
+
+		if (version1 % 2 != 0 || version2 % 2 != 0 || array_.load(std::memory_order_acquire) != array)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		bool found = false;
+		uint64_t valueWord = 0;
+		const Bucket* buckets[2] = { &array->buckets[bucket1], &array->buckets[bucket2] };
+
+		for (int b = 0; b < 2 && !found; b++)
+		{
+			int slot = findSlot(*buckets[b], keyWord);
+
+			if (slot != -1)
+			{
+				valueWord = buckets[b]->values[slot].load(std::memory_order_relaxed);
+				found = true;
+			}
+		}
+
+		// Keep the slot reads before the second reading of the versions
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (stripe1.version.load(std::memory_order_relaxed) != version1 || stripe2.version.load(std::memory_order_relaxed) != version2)
+			continue;
+
+		if (found)
+			value = decode<T2>(valueWord);
+
+		return found;
+	}
+}
+
+template <typename T1, typename T2, typename Hash>
+bool ConcurrentCuckooTable<T1, T2, Hash>::contains(const T1& key) const
+{
+	T2 value;
+
+	return find(key, value);
+}
+
+// Remove the key, return whether it was there
+template <typename T1, typename T2, typename Hash>
+bool ConcurrentCuckooTable<T1, T2, Hash>::tryRemove(const T1& key)
+{
+	uint64_t keyWord = encode(key);
+	size_t bucket1, bucket2;
+	BucketArray* array = lockBuckets(hash(key), bucket1, bucket2);
+	size_t indexes[2] = { bucket1, bucket2 };
+	bool removed = false;
+
+	for (int b = 0; b < 2 && !removed; b++)
+	{
+		int slot = findSlot(array->buckets[indexes[b]], keyWord);
+
+		if (slot != -1)
+		{
+			array->buckets[indexes[b]].keys[slot].store(EMPTY_KEY, std::memory_order_relaxed);
+			stripeOf(indexes[b]).elements.fetch_sub(1, std::memory_order_relaxed);
+			removed = true;
+		}
+	}
+
+	unlockBuckets(bucket1, bucket2);
+
+	return removed;
+}
+
+// Number of keys, exact only while no writer is running
+template <typename T1, typename T2, typename Hash>
+size_t ConcurrentCuckooTable<T1, T2, Hash>::getSize() const
+{
+	long long size = 0;
+
+	for (size_t i = 0; i < VERSION_STRIPES; i++)
+		size += stripes_[i].elements.load(std::memory_order_relaxed);
+
+	return static_cast<size_t>(size);
+}
+
+template <typename T1, typename T2, typename Hash>
+size_t ConcurrentCuckooTable<T1, T2, Hash>::getCapacity() const
+{
+	return array_.load(std::memory_order_acquire)->size * CONCURRENT_BUCKET_SLOTS;
+}
+
+#endif
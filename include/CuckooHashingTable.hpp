@@ -2,32 +2,76 @@
 #define CUCKOO_HASHING_TABLE_HPP
 
 #define CYCLE_LIMIT 5
-#define ALPHA 0.618 // Golden ratio factorial part
+#define RESEED_LIMIT 3 // Number of new hash functions tried before doubling the size
+#define GROW_LOAD 0.4 // Load of both arrays above which a failed placement doubles the size right away
 
 #include "HashTable.hpp"
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
 #include "Node.hpp"
+#include "SlotBitmap.hpp"
+#include "Prefetch.hpp"
+#include "Timer.hpp"
 
 #include <vector>
 #include <functional>
-#include <cmath>
+#include <cstdint>
+#include <utility>
 
-template <typename T1, typename T2>
+// Counters of the rehashes done by a table, durations are in nanoseconds
+struct RehashStats
+{
+	size_t rehashes = 0;
+	size_t reseeds = 0;
+	size_t grows = 0;
+	double lastDuration = 0.0;
+	double totalDuration = 0.0;
+};
+
+// Both slots of a key are derived from one hash of the key, which does not depend on the seed: mixing
+// it with the seed gives the first slot, mixing it with the seed and a constant gives the second one.
+// Keys that are not scalars store that hash (see StoredHash), so lookups compare full keys only when
+// it matches, and neither evictions nor rehashing with a new seed or size ever hash a key again
+template <typename T1, typename T2, typename Hash = Hasher<T1>, typename Range = ModuloRange>
 class CuckooHashingTable : public HashTable<T1, T2>
 {
 private:
-	std::vector<Node<T1, T2>> array1_;
-	std::vector<Node<T1, T2>> array2_;
+	struct Slot : Node<T1, T2>, StoredHash<T1> {};
+
+	std::vector<Slot> array1_;
+	std::vector<Slot> array2_;
+	SlotBitmap occupied1_;		// Slots of the first array in use
+	SlotBitmap occupied2_;		// Slots of the second array in use
 
 	size_t size_;
 	size_t elements_;
 	float loadFactor_;
 
-	size_t hash(int key, int type = 0);
-	size_t hash(float key, int type = 0);
-	size_t hash(char key, int type = 0);
-	size_t hash(std::string key, int type = 0);
-
-	void rehash();
+	uint64_t seed_;
+	int maxLoop_;
+	RehashStats stats_;
+
+	template <typename K>
+	uint64_t hash(const K& key);
+	size_t index(uint64_t hashValue, int type);
+	size_t nextOccupied(size_t from);
+	template <typename K>
+	T2* lookup(const K& key, uint64_t hashValue);
+	template <typename K>
+	T2* lookup(const K& key, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2);
+	template <typename K>
+	bool erase(const K& key, uint64_t hashValue);
+	template <typename K>
+	bool erase(const K& key, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2);
+	void insertHashed(T1&& key, T2&& value, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2);
+	void prefetch(size_t arrayIndex1, size_t arrayIndex2);
+	template <typename Operation>
+	void forEachBatch(const T1* keys, size_t count, Operation operation);
+
+	bool place(T1& key, T2& value, uint64_t& hashValue);
+	void resize(size_t size);
+	bool rebuild(T1& key, T2& value, uint64_t& hashValue);
+	void rehash(T1& key, T2& value, uint64_t& hashValue);
 
 public:
 	CuckooHashingTable(size_t size);
@@ -35,272 +79,435 @@ public:
 
 	void insert(T1 key, T2 value) override;
 	void remove(T1 key) override;
+	T2* find(const T1& key) override;
+	bool tryRemove(const T1& key) override;
 	void display();
 
-	size_t calculateLoadFactor();
+	void findBatch(const T1* keys, size_t count, T2** values) override;
+	void insertBatch(const T1* keys, const T2* values, size_t count) override;
+	size_t removeBatch(const T1* keys, size_t count) override;
+
+	// Lookups with any key type a transparent hasher accepts, e.g. std::string_view for std::string keys
+	using HashTable<T1, T2>::contains;
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	T2* find(const K& key) { return lookup(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const K& key) { return lookup(key, hash(key)) != nullptr; }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool tryRemove(const K& key) { return erase(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	void remove(const K& key) { erase(key, hash(key)); }
+
+	float calculateLoadFactor();
+	RehashStats getRehashStats() const;
 };
 
 // Initialize tables with default values
-template <typename T1, typename T2>
-CuckooHashingTable<T1, T2>::CuckooHashingTable(size_t size): size_(size), array1_(size), array2_(size), elements_(0), loadFactor_(0.0)
+template <typename T1, typename T2, typename Hash, typename Range>
+CuckooHashingTable<T1, T2, Hash, Range>::CuckooHashingTable(size_t size): size_(0), elements_(0), loadFactor_(0.0), seed_(0), maxLoop_(CYCLE_LIMIT)
 {
-	
+	resize(size > 0 ? size : 1);
 }
 
-template <typename T1, typename T2>
-CuckooHashingTable<T1, T2>::~CuckooHashingTable()
+template <typename T1, typename T2, typename Hash, typename Range>
+CuckooHashingTable<T1, T2, Hash, Range>::~CuckooHashingTable()
 {
 	// In progress
 }
 
-// Calculate index
-template <typename T1, typename T2>
-size_t CuckooHashingTable<T1, T2>::hash(int key, int type = 0)
+// Hash of the key, independent of the seed
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+uint64_t CuckooHashingTable<T1, T2, Hash, Range>::hash(const K& key)
 {
-	size_t hashValue = 0;
-
-	switch (type)
-	{
-		case 0:
-		{
-			hashValue = key % size_;
-			break;
-		}
+	Hash hashFunction;
 
-		// Multiplicatvie hashing
-		case 1:
-		{
-			double nominator = static_cast<size_t>(ALPHA * key) % static_cast<size_t>(pow(2, 16));
-			hashValue = std::floor(nominator / (pow(2, 16) / size_));
-			break;
-		}
-	}
+	return hashFunction(key);
+}
 
-	return hashValue;
+// Calculate index from the hash of a key, type selects the first or the second function of the current seed
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t CuckooHashingTable<T1, T2, Hash, Range>::index(uint64_t hashValue, int type)
+{
+	return Range::reduce(hashing::mix(hashValue ^ (type == 0 ? seed_ : seed_ ^ 0x9e3779b97f4a7c15ULL)), size_);
 }
 
-// Calculate index
-template <typename T1, typename T2>
-size_t CuckooHashingTable<T1, T2>::hash(float key, int type = 0)
+// Return the first index at or after from whose slot is in use in either array, or size_ if there is none
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t CuckooHashingTable<T1, T2, Hash, Range>::nextOccupied(size_t from)
 {
-	std::hash<float> hashFunction;
-	size_t hashValue = 0;
+	size_t index1 = occupied1_.findNext(from);
+	size_t index2 = occupied2_.findNext(from);
+
+	return index1 < index2 ? index1 : index2;
+}
 
-	switch (type)
+// Run the eviction loop for a key that is not in the table yet. The hash travels with the key.
+// If a cycle is detected, key, value and hashValue hold the element that was left without a slot
+template <typename T1, typename T2, typename Hash, typename Range>
+bool CuckooHashingTable<T1, T2, Hash, Range>::place(T1& key, T2& value, uint64_t& hashValue)
+{
+	// Detect cycle occurence by counting interations
+	for (int i = 0; i < maxLoop_; i++)
 	{
-		case 0:
+		int arrayIndex1 = index(hashValue, 0);
+
+		// If slot is empty then insert current key into 1st table
+		if (!occupied1_.test(arrayIndex1))
 		{
-			hashValue = hashFunction(key);
-			break;
+			array1_[arrayIndex1].key = std::move(key);
+			array1_[arrayIndex1].value = std::move(value);
+			array1_[arrayIndex1].setHash(hashValue);
+			occupied1_.set(arrayIndex1);
+
+			return true;
 		}
 
-		// Multiplicatvie hashing
-		case 1:
+		// If slot was occupied, insert current key into 1st table and keep old key
+		uint64_t evictedHash = array1_[arrayIndex1].getHash(array1_[arrayIndex1].key, Hash());
+		std::swap(key, array1_[arrayIndex1].key);
+		std::swap(value, array1_[arrayIndex1].value);
+		array1_[arrayIndex1].setHash(hashValue);
+		hashValue = evictedHash;
+
+		int arrayIndex2 = index(hashValue, 1);
+
+		// Insert old key into 2nd array
+		if (!occupied2_.test(arrayIndex2))
 		{
-			double nominator = static_cast<size_t>(ALPHA * key) % static_cast<size_t>(pow(2, 16));
-			hashValue = std::floor(nominator / (pow(2, 16) / size_));
-			break;
+			array2_[arrayIndex2].key = std::move(key);
+			array2_[arrayIndex2].value = std::move(value);
+			array2_[arrayIndex2].setHash(hashValue);
+			occupied2_.set(arrayIndex2);
+
+			return true;
 		}
+
+		// Again if slot was occupied, insert current key into 2nd table and keep old key
+		evictedHash = array2_[arrayIndex2].getHash(array2_[arrayIndex2].key, Hash());
+		std::swap(key, array2_[arrayIndex2].key);
+		std::swap(value, array2_[arrayIndex2].value);
+		array2_[arrayIndex2].setHash(hashValue);
+		hashValue = evictedHash;
 	}
 
-	return hashValue;
+	return false;
 }
 
-// Calculate index
-template <typename T1, typename T2>
-size_t CuckooHashingTable<T1, T2>::hash(char key, int type = 0)
+// Start loading both slots of a key. The bitmaps are left to the cache, they are 64 times smaller
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::prefetch(size_t arrayIndex1, size_t arrayIndex2)
 {
-	char asciiValue = int(key);
-	size_t hashValue = 0;
+	prefetchLine(&array1_[arrayIndex1]);
+	prefetchLine(&array2_[arrayIndex2]);
+}
 
-	switch (type)
-	{
-		case 0:
-		{
-			hashValue = (asciiValue) % size_;
-			break;
-		}
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::insert(T1 key, T2 value)
+{
+	uint64_t hashValue = hash(key);
 
-		// Multiplicatvie hashing
-		case 1:
-		{
-			double nominator = static_cast<size_t>(ALPHA * asciiValue) % static_cast<size_t>(pow(2, 16));
-			hashValue = std::floor(nominator / (pow(2, 16) / size_));
-			break;
-		}
-	}
+	insertHashed(std::move(key), std::move(value), hashValue, index(hashValue, 0), index(hashValue, 1));
+}
+
+// Insert key-value pair at calculated index, hashValue is the hash of the key and arrayIndex1 and
+// arrayIndex2 are its slots under the current seed and size
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::insertHashed(T1&& key, T2&& value, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2)
+{
+	// If key is already present, do not insert
+	if ((occupied1_.test(arrayIndex1) && array1_[arrayIndex1].hashMatches(hashValue) && array1_[arrayIndex1].key == key) ||
+		(occupied2_.test(arrayIndex2) && array2_[arrayIndex2].hashMatches(hashValue) && array2_[arrayIndex2].key == key))
+		return;
+
+	// If we fail to place the key then a cycle must have occured.
+	// To handle a cycle we rehash, which also places the element left without a slot
+	if (!place(key, value, hashValue))
+		rehash(key, value, hashValue);
 
-	return hashValue;
+	elements_++;
 }
 
-// Calculate index
-template <typename T1, typename T2>
-size_t CuckooHashingTable<T1, T2>::hash(std::string key, int type = 0)
+// Remove the key, nothing happens if it is not there
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::remove(T1 key)
 {
-	int sum = 0;
+	tryRemove(key);
+}
 
-	for (int i = 0; i < key.size(); i++)
-		sum += int(key[i]) * pow(31, i);
+template <typename T1, typename T2, typename Hash, typename Range>
+bool CuckooHashingTable<T1, T2, Hash, Range>::tryRemove(const T1& key)
+{
+	return erase(key, hash(key));
+}
 
-	size_t hashValue = 0;
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+bool CuckooHashingTable<T1, T2, Hash, Range>::erase(const K& key, uint64_t hashValue)
+{
+	return erase(key, hashValue, index(hashValue, 0), index(hashValue, 1));
+}
 
-	switch (type)
+// Find if key is present in 1st or second table and remove it by reseting a node to default values
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+bool CuckooHashingTable<T1, T2, Hash, Range>::erase(const K& key, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2)
+{
+	if (occupied1_.test(arrayIndex1) && array1_[arrayIndex1].hashMatches(hashValue) && array1_[arrayIndex1].key == key)
 	{
-		case 0:
-		{
-			hashValue = sum % size_;
-			break;
-		}
+		array1_[arrayIndex1] = Slot();
+		occupied1_.reset(arrayIndex1);
 
-		// Multiplicatvie hashing
-		case 1:
-		{
-			double nominator = static_cast<size_t>(ALPHA * sum) % static_cast<size_t>(pow(2, 16));
-			hashValue = std::floor(nominator / (pow(2, 16) / size_));
-			break;
-		}
+		elements_--;
+
+		return true;
+	}
+
+	if (occupied2_.test(arrayIndex2) && array2_[arrayIndex2].hashMatches(hashValue) && array2_[arrayIndex2].key == key)
+	{
+		array2_[arrayIndex2] = Slot();
+		occupied2_.reset(arrayIndex2);
+
+		elements_--;
+
+		return true;
 	}
 
-	return hashValue;
+	return false;
 }
 
-// Insert key-value pair at calculated index
-template <typename T1, typename T2>
-void CuckooHashingTable<T1, T2>::insert(T1 key, T2 value)
+template <typename T1, typename T2, typename Hash, typename Range>
+T2* CuckooHashingTable<T1, T2, Hash, Range>::find(const T1& key)
 {
-	int arrayIndex1 = hash(key, 0); 
-	int arrayIndex2 = hash(key, 1);
-
-	// If key is already present, do not insert
-	if ((!array1_[arrayIndex1].isEmpty && array1_[arrayIndex1].key == key) || 
-		(!array2_[arrayIndex2].isEmpty && array2_[arrayIndex2].key == key))
-		return;
+	return lookup(key, hash(key));
+}
 
-	// Detect cycle occurence by counting interations
-	for (int i = 0; i < CYCLE_LIMIT; i++)
-	{
-		// If slot is empty then insert current key into 1st table
-		if (array1_[arrayIndex1].isEmpty)
-		{
-			array1_[arrayIndex1].key = key;
-			array1_[arrayIndex1].value = value;
-			array1_[arrayIndex1].isEmpty = false;
+// Return a pointer to the value stored with the key in one of its two slots, or nullptr
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+T2* CuckooHashingTable<T1, T2, Hash, Range>::lookup(const K& key, uint64_t hashValue)
+{
+	int arrayIndex1 = index(hashValue, 0);
 
-			elements_++;
-			return;
-		}
+	if (occupied1_.test(arrayIndex1) && array1_[arrayIndex1].hashMatches(hashValue) && array1_[arrayIndex1].key == key)
+		return &array1_[arrayIndex1].value;
 
-		// If slot was occupied, insert current key into 1st table and keep old key
-		std::swap(key, array1_[arrayIndex1].key);
-		std::swap(value, array1_[arrayIndex1].value);
+	int arrayIndex2 = index(hashValue, 1);
 
-		arrayIndex2 = hash(key, 1);
+	if (occupied2_.test(arrayIndex2) && array2_[arrayIndex2].hashMatches(hashValue) && array2_[arrayIndex2].key == key)
+		return &array2_[arrayIndex2].value;
 
-		// Insert old key into 2nd array
-		if (array2_[arrayIndex2].isEmpty)
-		{
-			array2_[arrayIndex2].key = key;
-			array2_[arrayIndex2].value = value;
-			array2_[arrayIndex2].isEmpty = false;
+	return nullptr;
+}
 
-			elements_++;
-			return;
-		}
+// Same lookup with both slots of the key computed already
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+T2* CuckooHashingTable<T1, T2, Hash, Range>::lookup(const K& key, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2)
+{
+	if (occupied1_.test(arrayIndex1) && array1_[arrayIndex1].hashMatches(hashValue) && array1_[arrayIndex1].key == key)
+		return &array1_[arrayIndex1].value;
 
-		// Again if slot was occupied, insert current key into 2nd table and keep old key
-		std::swap(key, array2_[arrayIndex2].key);
-		std::swap(value, array2_[arrayIndex2].value);
-	}
+	if (occupied2_.test(arrayIndex2) && array2_[arrayIndex2].hashMatches(hashValue) && array2_[arrayIndex2].key == key)
+		return &array2_[arrayIndex2].value;
 
-	// If we come to this point then the cycle must have occured
-	// To handle a cycle we perform rehashing and call insert for rehashed tables
-	rehash();
-	insert(key, value);
+	return nullptr;
 }
 
-// Find if key is present in 1st or second table and remove it by reseting a node to default values
-template <typename T1, typename T2>
-void CuckooHashingTable<T1, T2>::remove(T1 key)
+// Call operation(i, hashValue, arrayIndex1, arrayIndex2) for every key, a batch of keys at a time. Every
+// key of a batch is hashed and both of its slots computed and prefetched before the first of them is
+// resolved. The slots are computed once: with ModuloRange each of them costs a division. They depend on
+// the seed and the size, and are computed again for the keys left in a batch when an insert of it rehashes
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename Operation>
+void CuckooHashingTable<T1, T2, Hash, Range>::forEachBatch(const T1* keys, size_t count, Operation operation)
 {
-	int arrayIndex1 = hash(key, 0);
-	int arrayIndex2 = hash(key, 1);
+	uint64_t hashes[PREFETCH_BATCH];
+	size_t indices[PREFETCH_BATCH][2];
 
-	
-	if (array1_[arrayIndex1].isEmpty == false && array1_[arrayIndex1].key == key)
+	for (size_t start = 0; start < count; start += PREFETCH_BATCH)
 	{
-		array1_[arrayIndex1].key = T1();
-		array1_[arrayIndex1].value = T2();
-		array1_[arrayIndex1].isEmpty = true;
+		size_t batch = count - start < PREFETCH_BATCH ? count - start : PREFETCH_BATCH;
+		size_t rehashes = stats_.rehashes;
 
-		elements_--;
+		for (size_t i = 0; i < batch; i++)
+		{
+			hashes[i] = hash(keys[start + i]);
+			indices[i][0] = index(hashes[i], 0);
+			indices[i][1] = index(hashes[i], 1);
+			prefetch(indices[i][0], indices[i][1]);
+		}
 
-		return;
+		for (size_t i = 0; i < batch; i++)
+		{
+			if (stats_.rehashes != rehashes)
+			{
+				indices[i][0] = index(hashes[i], 0);
+				indices[i][1] = index(hashes[i], 1);
+			}
+
+			operation(start + i, hashes[i], indices[i][0], indices[i][1]);
+		}
 	}
+}
 
-	if (array2_[arrayIndex2].isEmpty == false && array2_[arrayIndex2].key == key)
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::findBatch(const T1* keys, size_t count, T2** values)
+{
+	forEachBatch(keys, count, [this, keys, values](size_t i, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2) { values[i] = lookup(keys[i], hashValue, arrayIndex1, arrayIndex2); });
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::insertBatch(const T1* keys, const T2* values, size_t count)
+{
+	forEachBatch(keys, count, [this, keys, values](size_t i, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2) { insertHashed(T1(keys[i]), T2(values[i]), hashValue, arrayIndex1, arrayIndex2); });
+}
+
+// Remove every key of the array that is there, return the number of keys removed
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t CuckooHashingTable<T1, T2, Hash, Range>::removeBatch(const T1* keys, size_t count)
+{
+	size_t removed = 0;
+
+	forEachBatch(keys, count, [this, keys, &removed](size_t i, uint64_t hashValue, size_t arrayIndex1, size_t arrayIndex2)
 	{
-		array2_[arrayIndex2].key = T1();
-		array2_[arrayIndex2].value = T2();
-		array2_[arrayIndex2].isEmpty = true;
+		if (erase(keys[i], hashValue, arrayIndex1, arrayIndex2))
+			removed++;
+	});
 
-		elements_--;
+	return removed;
+}
 
-		return;
-	}
+template <typename T1, typename T2, typename Hash, typename Range>
+float CuckooHashingTable<T1, T2, Hash, Range>::calculateLoadFactor()
+{
+	loadFactor_ = static_cast<float>(elements_) / (size_ * 2);
+
+	return loadFactor_;
 }
 
-template <typename T1, typename T2>
-size_t CuckooHashingTable<T1, T2>::calculateLoadFactor()
+// Return counters and timings of every rehash done so far
+template <typename T1, typename T2, typename Hash, typename Range>
+RehashStats CuckooHashingTable<T1, T2, Hash, Range>::getRehashStats() const
 {
-	loadFactor_ = elements_ / size_;
+	return stats_;
 }
 
-// Double the size and insert elements with new hash functions
-template <typename T1, typename T2>
-void CuckooHashingTable<T1, T2>::rehash()
+// Set the size of both arrays, as rounded by the range policy, and the eviction limit that goes with it
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::resize(size_t size)
 {
-	//std::cout << "rehash called\n";
+	size_ = Range::capacity(size);
 
-	std::vector<Node<T1, T2>> temp1 = array1_;
-	std::vector<Node<T1, T2>> temp2 = array2_;
+	array1_.resize(size_);
+	array2_.resize(size_);
+	occupied1_.resize(size_);
+	occupied2_.resize(size_);
 
-	array1_.clear();
-	array2_.clear();
+	// Eviction chains of O(log n) steps succeed with high probability below half load
+	maxLoop_ = CYCLE_LIMIT;
 
-	array1_.resize(size_ * 2);
-	array2_.resize(size_ * 2);
+	for (size_t i = size_; i > 1; i /= 2)
+		maxLoop_ += 3;
+}
 
-	elements_ = 0;
-	size_ *= 2;
+// Move every element that is not at its position under the current hash functions, in place.
+// The element left without a slot by the previous attempt is placed first. Runs of empty slots are
+// skipped a bitmap word at a time.
+// On failure key, value and hashValue hold the element that is now left without a slot
+template <typename T1, typename T2, typename Hash, typename Range>
+bool CuckooHashingTable<T1, T2, Hash, Range>::rebuild(T1& key, T2& value, uint64_t& hashValue)
+{
+	if (!place(key, value, hashValue))
+		return false;
 
-	for (int i = 0; i < temp1.size(); i++)
+	for (size_t i = nextOccupied(0); i < size_; i = nextOccupied(i + 1))
 	{
-		if (!temp1[i].isEmpty)
+		if (occupied1_.test(i))
 		{
-			insert(temp1[i].key, temp1[i].value);
+			uint64_t storedHash = array1_[i].getHash(array1_[i].key, Hash());
+
+			if (index(storedHash, 0) != i)
+			{
+				key = std::move(array1_[i].key);
+				value = std::move(array1_[i].value);
+				hashValue = storedHash;
+				array1_[i] = Slot();
+				occupied1_.reset(i);
+
+				if (!place(key, value, hashValue))
+					return false;
+			}
+		}
+
+		if (occupied2_.test(i))
+		{
+			uint64_t storedHash = array2_[i].getHash(array2_[i].key, Hash());
+
+			if (index(storedHash, 1) != i)
+			{
+				key = std::move(array2_[i].key);
+				value = std::move(array2_[i].value);
+				hashValue = storedHash;
+				array2_[i] = Slot();
+				occupied2_.reset(i);
+
+				if (!place(key, value, hashValue))
+					return false;
+			}
 		}
 	}
 
-	for (int i = 0; i < temp2.size(); i++)
+	return true;
+}
+
+// Pick new hash functions and rebuild the arrays in place until every element fits.
+// Near half load reseeding almost never helps and every failed attempt costs a full rebuild, so the
+// size is doubled right away above GROW_LOAD, and otherwise only if reseeding keeps failing
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::rehash(T1& key, T2& value, uint64_t& hashValue)
+{
+	//std::cout << "rehash called\n";
+
+	Timer timer;
+	timer.start();
+
+	int attempts = elements_ + 1 >= GROW_LOAD * 2 * size_ ? RESEED_LIMIT : 0;
+
+	while (true)
 	{
-		if (!temp2[i].isEmpty)
+		if (attempts == RESEED_LIMIT)
 		{
-			insert(temp2[i].key, temp2[i].value);
+			resize(size_ * 2);
+			stats_.grows++;
+			attempts = 0;
 		}
+
+		// Derive the next seed from the current one
+		seed_ = (seed_ + 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL;
+		seed_ ^= seed_ >> 31;
+		stats_.reseeds++;
+		attempts++;
+
+		if (rebuild(key, value, hashValue))
+			break;
 	}
+
+	timer.stop();
+
+	stats_.rehashes++;
+	stats_.lastDuration = timer.getDuration();
+	stats_.totalDuration += stats_.lastDuration;
 }
 
 // Display both tables
-template <typename T1, typename T2>
-void CuckooHashingTable<T1, T2>::display()
+template <typename T1, typename T2, typename Hash, typename Range>
+void CuckooHashingTable<T1, T2, Hash, Range>::display()
 {
 	std::cout << "Array 1 | Array 2\n";
 
-	for (int i = 0; i < size_; i++)
-	{
-		if(array1_[i].isEmpty == false || array2_[i].isEmpty == false)
-			std::cout << i << ": { " << array1_[i].key << ", " << array1_[i].value << " } { " << array2_[i].key << ", " << array2_[i].value << " }\n";
-	}
+	for (size_t i = nextOccupied(0); i < size_; i = nextOccupied(i + 1))
+		std::cout << i << ": { " << array1_[i].key << ", " << array1_[i].value << " } { " << array2_[i].key << ", " << array2_[i].value << " }\n";
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,172 @@
+#ifndef EPOCH_RECLAMATION_HPP
+#define EPOCH_RECLAMATION_HPP
+
+#define EPOCH_SLOTS 128		// Number of operations that can be inside the domain at once
+#define RETIRE_THRESHOLD 64	// Number of retired objects a slot collects before it tries to free some
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Epoch based reclamation for lock-free structures. An object unlinked from a structure may still be
+// read by operations that found it before, so it is retired instead of deleted, and deleted once every
+// operation that could have seen it has finished.
+// The domain keeps a global epoch. An operation runs inside a Guard, which occupies a slot announcing the
+// epoch the operation started in. The epoch only moves forward once every active slot announces the current
+// one, so an object retired in epoch e is unreachable for every running operation by epoch e + 2.
+// Slots are taken per operation rather than per thread, so threads need no registration, and an operation
+// that stalls only delays freeing memory, never other operations
+class EpochDomain
+{
+private:
+	struct Retired
+	{
+		void* object;
+		void (*deleter)(void*);
+		uint64_t epoch;
+	};
+
+	// Bit 0 is set while an operation holds the slot, the other bits hold the epoch it announced.
+	// Retired objects belong to the slot and are only touched by its holder
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> state{ 0 };
+		std::vector<Retired> retired;
+		size_t collectAt = RETIRE_THRESHOLD;	// Number of retired objects that triggers the next collection
+	};
+
+	std::atomic<uint64_t> epoch_;
+	std::unique_ptr<Slot[]> slots_;
+
+	bool tryAdvance(uint64_t epoch);
+	void collect(Slot& slot);
+
+	EpochDomain(const EpochDomain&) = delete;
+	EpochDomain& operator=(const EpochDomain&) = delete;
+
+public:
+	// Keeps the objects an operation reads from being deleted until it ends
+	class Guard
+	{
+	private:
+		EpochDomain& domain_;
+		Slot* slot_;
+
+		Guard(const Guard&) = delete;
+		Guard& operator=(const Guard&) = delete;
+
+	public:
+		Guard(EpochDomain& domain);
+		~Guard();
+
+		template <typename T>
+		void retire(T* object);
+	};
+
+	EpochDomain();
+	~EpochDomain();
+};
+
+inline EpochDomain::EpochDomain() : epoch_(0), slots_(new Slot[EPOCH_SLOTS]) {}
+
+// Delete everything still retired, no operation may be running
+inline EpochDomain::~EpochDomain()
+{
+	for (size_t i = 0; i < EPOCH_SLOTS; i++)
+	{
+		for (Retired& retired : slots_[i].retired)
+			retired.deleter(retired.object);
+	}
+}
+
+// Move the global epoch from epoch to the next one if every active operation announces epoch
+inline bool EpochDomain::tryAdvance(uint64_t epoch)
+{
+	for (size_t i = 0; i < EPOCH_SLOTS; i++)
+	{
+		uint64_t state = slots_[i].state.load(std::memory_order_seq_cst);
+
+		if ((state & 1) != 0 && (state >> 1) != epoch)
+			return false;
+	}
+
+	return epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+// Delete the objects of a slot retired at least two epochs ago
+inline void EpochDomain::collect(Slot& slot)
+{
+	uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+
+	if (tryAdvance(epoch))
+		epoch++;
+
+	size_t kept = 0;
+
+	for (size_t i = 0; i < slot.retired.size(); i++)
+	{
+		if (slot.retired[i].epoch + 2 <= epoch)
+			slot.retired[i].deleter(slot.retired[i].object);
+		else
+			slot.retired[kept++] = slot.retired[i];
+	}
+
+	slot.retired.resize(kept);
+
+	// Objects that could not go yet are not scanned again on every retire while the epoch is held back
+	slot.collectAt = kept * 2 > RETIRE_THRESHOLD ? kept * 2 : RETIRE_THRESHOLD;
+}
+
+// Take a free slot, starting from one picked by the thread so threads rarely compete for a slot, and
+// announce the current epoch in it. The announcement is repeated until the epoch did not move meanwhile
+inline EpochDomain::Guard::Guard(EpochDomain& domain) : domain_(domain), slot_(nullptr)
+{
+	size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % EPOCH_SLOTS;
+	uint64_t epoch = domain_.epoch_.load(std::memory_order_seq_cst);
+
+	while (true)
+	{
+		uint64_t expected = 0;
+
+		if (domain_.slots_[index].state.compare_exchange_strong(expected, (epoch << 1) | 1, std::memory_order_seq_cst))
+			break;
+
+		index = (index + 1) % EPOCH_SLOTS;
+
+		if (index == 0)
+			std::this_thread::yield();
+	}
+
+	slot_ = &domain_.slots_[index];
+
+	uint64_t current = domain_.epoch_.load(std::memory_order_seq_cst);
+
+	while (current != epoch)
+	{
+		epoch = current;
+		slot_->state.store((epoch << 1) | 1, std::memory_order_seq_cst);
+		current = domain_.epoch_.load(std::memory_order_seq_cst);
+	}
+}
+
+// Leave the slot, objects retired in it wait there for a later holder to delete them
+inline EpochDomain::Guard::~Guard()
+{
+	slot_->state.store(0, std::memory_order_release);
+}
+
+// Hand an object that no new operation can reach to the domain, it is deleted once no running one can
+template <typename T>
+void EpochDomain::Guard::retire(T* object)
+{
+	slot_->retired.push_back({ object, [](void* pointer) { delete static_cast<T*>(pointer); }, domain_.epoch_.load(std::memory_order_seq_cst) });
+
+	if (slot_->retired.size() >= slot_->collectAt)
+		domain_.collect(*slot_);
+}
+
+#endif
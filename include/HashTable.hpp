@@ -1,18 +1,132 @@
 #ifndef HASH_TABLE_HPP
 #define HASH_TABLE_HPP
 
-template <typename T1, typename T2>
-class CuckooHashingTable;
-
-template <typename T1, typename T2>
-class ClosedAddressingTable;
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
 
+// Interface of every table. find and tryRemove report a missing key through their return value and
+// never throw, which keeps lookups that often miss cheap. search throws std::out_of_range instead,
+// for callers that treat a missing key as an error.
+// insert takes its arguments by value and every table moves them on into its slot or node, so a key or
+// value passed as an rvalue is moved all the way and never copied. emplace, tryEmplace and insertOrAssign
+// build on insert and find: the value is constructed right in the argument of insert.
+// The batch operations work on arrays of keys. Hash tables override them to hash every key of a batch
+// and prefetch its slot or bucket before resolving any of them; the defaults run one key at a time
 template <typename T1, typename T2>
 class HashTable
 {
 public:
+	virtual ~HashTable() {}
+
 	virtual void insert(T1 key, T2 value) = 0;
 	virtual void remove(T1 key) = 0;
+
+	// Return a pointer to the value stored with the key, or nullptr. The pointer is valid until the table is modified
+	virtual T2* find(const T1& key) = 0;
+	// Remove the key if it is there, return whether it was
+	virtual bool tryRemove(const T1& key) = 0;
+
+	bool contains(const T1& key);
+	T2 search(const T1& key);
+
+	// Store find(keys[i]) in values[i] for every key
+	virtual void findBatch(const T1* keys, size_t count, T2** values);
+	// Insert keys[i] with values[i] in order, an insert that throws leaves the earlier ones done
+	virtual void insertBatch(const T1* keys, const T2* values, size_t count);
+	// Remove every key that is there, return the number of keys removed
+	virtual size_t removeBatch(const T1* keys, size_t count);
+
+	template <typename K, typename... Args>
+	void emplace(K&& key, Args&&... args);
+	template <typename K, typename... Args>
+	bool tryEmplace(K&& key, Args&&... args);
+	template <typename K, typename M>
+	bool insertOrAssign(K&& key, M&& value);
 };
 
-#endif
\ No newline at end of file
+template <typename T1, typename T2>
+bool HashTable<T1, T2>::contains(const T1& key)
+{
+	return find(key) != nullptr;
+}
+
+// Return a copy of the value stored with the key, throw if there is none
+template <typename T1, typename T2>
+T2 HashTable<T1, T2>::search(const T1& key)
+{
+	T2* value = find(key);
+
+	if (value == nullptr)
+		throw std::out_of_range("Key not found");
+
+	return *value;
+}
+
+template <typename T1, typename T2>
+void HashTable<T1, T2>::findBatch(const T1* keys, size_t count, T2** values)
+{
+	for (size_t i = 0; i < count; i++)
+		values[i] = find(keys[i]);
+}
+
+template <typename T1, typename T2>
+void HashTable<T1, T2>::insertBatch(const T1* keys, const T2* values, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		insert(keys[i], values[i]);
+}
+
+template <typename T1, typename T2>
+size_t HashTable<T1, T2>::removeBatch(const T1* keys, size_t count)
+{
+	size_t removed = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (tryRemove(keys[i]))
+			removed++;
+	}
+
+	return removed;
+}
+
+// Construct the key and the value from the arguments and insert them, moving both into the table
+template <typename T1, typename T2>
+template <typename K, typename... Args>
+void HashTable<T1, T2>::emplace(K&& key, Args&&... args)
+{
+	insert(T1(std::forward<K>(key)), T2(std::forward<Args>(args)...));
+}
+
+// Construct and insert the value only if the key is not there yet, return whether it was inserted.
+// Nothing is constructed or moved from when the key exists
+template <typename T1, typename T2>
+template <typename K, typename... Args>
+bool HashTable<T1, T2>::tryEmplace(K&& key, Args&&... args)
+{
+	if (find(key) != nullptr)
+		return false;
+
+	insert(T1(std::forward<K>(key)), T2(std::forward<Args>(args)...));
+	return true;
+}
+
+// Assign the value to the key if it is there, insert the pair otherwise. Return true if it was inserted
+template <typename T1, typename T2>
+template <typename K, typename M>
+bool HashTable<T1, T2>::insertOrAssign(K&& key, M&& value)
+{
+	T2* current = find(key);
+
+	if (current != nullptr)
+	{
+		*current = std::forward<M>(value);
+		return false;
+	}
+
+	insert(T1(std::forward<K>(key)), T2(std::forward<M>(value)));
+	return true;
+}
+
+#endif
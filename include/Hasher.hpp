@@ -0,0 +1,243 @@
+#ifndef HASHER_HPP
+#define HASHER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <type_traits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Hash functions shared by every table. A table takes the hasher as a template parameter,
+// Hasher<T1> by default, and calls it as hash(key) or hash(key, seed). The seed selects one of a
+// family of independent functions, the bucketized cuckoo table uses it for its second function.
+// A custom hasher only needs to provide the same call operator. A hasher that also declares
+// is_transparent promises to hash equal keys of other types (compared with == against stored keys)
+// to the same value, and tables then accept those types in find, contains, tryRemove and remove
+namespace hashing
+{
+	// Multiply-xorshift finalizer, every input bit affects every output bit
+	inline uint64_t mix(uint64_t value)
+	{
+		value ^= value >> 32;
+		value *= 0xd6e8feb86659fd93ULL;
+		value ^= value >> 32;
+		value *= 0xd6e8feb86659fd93ULL;
+		value ^= value >> 32;
+
+		return value;
+	}
+
+	// Fold the 128 bit product of two 64 bit numbers
+	inline uint64_t multiplyFold(uint64_t a, uint64_t b)
+	{
+#if defined(__SIZEOF_INT128__)
+		__uint128_t product = static_cast<__uint128_t>(a) * b;
+
+		return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		uint64_t high;
+		uint64_t low = _umul128(a, b, &high);
+
+		return low ^ high;
+#else
+		uint64_t aHigh = a >> 32, aLow = a & 0xffffffffULL;
+		uint64_t bHigh = b >> 32, bLow = b & 0xffffffffULL;
+		uint64_t lowLow = aLow * bLow, lowHigh = aLow * bHigh, highLow = aHigh * bLow, highHigh = aHigh * bHigh;
+		uint64_t middle = (lowLow >> 32) + (lowHigh & 0xffffffffULL) + (highLow & 0xffffffffULL);
+		uint64_t low = (middle << 32) | (lowLow & 0xffffffffULL);
+		uint64_t high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+
+		return low ^ high;
+#endif
+	}
+
+	inline uint64_t read8(const unsigned char* data)
+	{
+		uint64_t value;
+		std::memcpy(&value, data, 8);
+		return value;
+	}
+
+	inline uint64_t read4(const unsigned char* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, 4);
+		return value;
+	}
+
+	// Hash of a byte string in the style of wyhash: 16 bytes per step, one wide multiplication each
+	inline uint64_t hashBytes(const void* bytes, size_t length, uint64_t seed)
+	{
+		const uint64_t secret0 = 0xa0761d6478bd642fULL;
+		const uint64_t secret1 = 0xe7037ed1a0b428dbULL;
+		const uint64_t secret2 = 0x8ebc6af09c88c6e3ULL;
+		const uint64_t secret3 = 0x589965cc75374cc3ULL;
+
+		const unsigned char* data = static_cast<const unsigned char*>(bytes);
+		uint64_t a = 0, b = 0;
+
+		seed ^= multiplyFold(seed ^ secret0, secret1);
+
+		if (length <= 16)
+		{
+			if (length >= 4)
+			{
+				size_t offset = (length >> 3) << 2;
+				a = (read4(data) << 32) | read4(data + offset);
+				b = (read4(data + length - 4) << 32) | read4(data + length - 4 - offset);
+			}
+			else if (length > 0)
+			{
+				a = (static_cast<uint64_t>(data[0]) << 16) | (static_cast<uint64_t>(data[length >> 1]) << 8) | data[length - 1];
+			}
+		}
+		else
+		{
+			size_t remaining = length;
+
+			// Three independent lanes for long strings
+			if (remaining > 48)
+			{
+				uint64_t lane1 = seed, lane2 = seed;
+
+				do
+				{
+					seed = multiplyFold(read8(data) ^ secret1, read8(data + 8) ^ seed);
+					lane1 = multiplyFold(read8(data + 16) ^ secret2, read8(data + 24) ^ lane1);
+					lane2 = multiplyFold(read8(data + 32) ^ secret3, read8(data + 40) ^ lane2);
+					data += 48;
+					remaining -= 48;
+				} while (remaining > 48);
+
+				seed ^= lane1 ^ lane2;
+			}
+
+			while (remaining > 16)
+			{
+				seed = multiplyFold(read8(data) ^ secret1, read8(data + 8) ^ seed);
+				data += 16;
+				remaining -= 16;
+			}
+
+			a = read8(data + remaining - 16);
+			b = read8(data + remaining - 8);
+		}
+
+		return multiplyFold(secret1 ^ length, multiplyFold(a ^ secret1, b ^ seed));
+	}
+}
+
+// Fallback for any type std::hash supports: the result of std::hash is mixed with the seed
+template <typename T, typename Enable = void>
+struct Hasher
+{
+	uint64_t operator()(const T& key, uint64_t seed = 0) const
+	{
+		std::hash<T> hashFunction;
+
+		return hashing::mix(static_cast<uint64_t>(hashFunction(key)) ^ seed);
+	}
+};
+
+// Integers (char included) go straight into the multiply-xorshift mixer
+template <typename T>
+struct Hasher<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+	uint64_t operator()(T key, uint64_t seed = 0) const
+	{
+		return hashing::mix(static_cast<uint64_t>(key) ^ seed);
+	}
+};
+
+// Floating point numbers are hashed by their bits, with 0.0 and -0.0 treated as the same key
+template <typename T>
+struct Hasher<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+	uint64_t operator()(T key, uint64_t seed = 0) const
+	{
+		if (key == 0)
+			key = 0;
+
+		uint64_t bits = 0;
+		std::memcpy(&bits, &key, sizeof(key) < sizeof(bits) ? sizeof(key) : sizeof(bits));
+
+		return hashing::mix(bits ^ seed);
+	}
+};
+
+// Strings use the byte string hash. It works on a view, so a std::string_view or a string literal
+// is looked up in a table of std::string without building a std::string first
+template <>
+struct Hasher<std::string>
+{
+	typedef void is_transparent;
+
+	uint64_t operator()(std::string_view key, uint64_t seed = 0) const
+	{
+		return hashing::hashBytes(key.data(), key.size(), seed);
+	}
+};
+
+template <>
+struct Hasher<std::string_view> : Hasher<std::string> {};
+
+// Hash of a key kept next to it in an entry or a node. Lookups compare full keys only when the stored
+// hash matches, and a table that moves the entry reuses it instead of hashing the key again. Scalar keys
+// are as cheap to compare and hash as the hash itself, so for them the struct is empty and every hash matches
+template <typename T, typename Enable = void>
+struct StoredHash
+{
+	uint64_t hashCode = 0;
+
+	void setHash(uint64_t hashValue)
+	{
+		hashCode = hashValue;
+	}
+
+	bool hashMatches(uint64_t hashValue) const
+	{
+		return hashCode == hashValue;
+	}
+
+	// The hash of the key, hashFunction(key) if it is not stored
+	template <typename Hash>
+	uint64_t getHash(const T&, const Hash&) const
+	{
+		return hashCode;
+	}
+
+	// The stored hash, for moving it into another entry. 0 if nothing is stored
+	uint64_t storedHash() const
+	{
+		return hashCode;
+	}
+};
+
+template <typename T>
+struct StoredHash<T, typename std::enable_if<std::is_scalar<T>::value>::type>
+{
+	void setHash(uint64_t) {}
+
+	bool hashMatches(uint64_t) const
+	{
+		return true;
+	}
+
+	template <typename Hash>
+	uint64_t getHash(const T& key, const Hash& hashFunction) const
+	{
+		return hashFunction(key);
+	}
+
+	uint64_t storedHash() const
+	{
+		return 0;
+	}
+};
+
+#endif
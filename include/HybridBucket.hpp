@@ -0,0 +1,233 @@
+#ifndef HYBRID_BUCKET_HPP
+#define HYBRID_BUCKET_HPP
+
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include "SinglyLinkedList.hpp"
+#include "AVL.hpp"
+#include "Hasher.hpp"
+
+#define TREEIFY_THRESHOLD 8	// A chain with this many entries turns into a tree on the next insert
+#define UNTREEIFY_THRESHOLD 6	// A tree with fewer entries turns back into a chain
+
+// Separate chaining bucket that starts as a linked list and switches to an AVL tree once the chain
+// gets long, the way buckets of Java's HashMap do. Well hashed keys practically never reach the
+// threshold, but badly hashed or adversarial keys landing in one bucket cost O(log n) per lookup
+// instead of O(n). The gap between the two thresholds keeps a bucket from converting back and forth.
+// Keys need operator< in addition to operator==
+template <typename T1, typename T2>
+class HybridBucket
+{
+public:
+	typedef typename SinglyLinkedList<T1, T2>::Pool Pool;
+
+private:
+	// Value of a tree node. The tree is searched by key order, the hash is only kept for when the
+	// entry leaves the tree
+	struct TreeValue : StoredHash<T1>
+	{
+		T2 value;
+
+		TreeValue() = default;
+
+		template <typename V>
+		TreeValue(V&& value, uint64_t hashValue) : value(std::forward<V>(value))
+		{
+			this->setHash(hashValue);
+		}
+	};
+
+	SinglyLinkedList<T1, T2> list_;			// Entries while the bucket is a chain
+	std::unique_ptr<AVL<T1, TreeValue>> tree_;	// Entries while the bucket is a tree, nullptr otherwise
+
+	void treeify();
+	void untreeify();
+
+public:
+	HybridBucket(Pool* pool = nullptr);
+	HybridBucket(HybridBucket<T1, T2>&& other);
+	HybridBucket(const HybridBucket<T1, T2>&) = delete;
+	HybridBucket<T1, T2>& operator=(const HybridBucket<T1, T2>&) = delete;
+
+	template <typename K, typename V>
+	void pushBack(K&& key, V&& value, uint64_t hashValue);
+	template <typename K>
+	T2* findValue(const K& key, uint64_t hashValue);
+	template <typename K>
+	bool erase(const K& key, uint64_t hashValue);
+	void prefetch() const;
+	void release();
+	void clear();
+
+	template <typename Function>
+	void forEach(Function function) const;
+	template <typename Function>
+	void drain(Function function);
+
+	int getSize() const;
+	bool isEmpty() const;
+	bool isTree() const;
+	void show() const;
+};
+
+template <typename T1, typename T2>
+HybridBucket<T1, T2>::HybridBucket(Pool* pool) : list_(pool) {}
+
+// Take over the chain or the tree of another bucket
+template <typename T1, typename T2>
+HybridBucket<T1, T2>::HybridBucket(HybridBucket<T1, T2>&& other) : list_(std::move(other.list_)), tree_(std::move(other.tree_)) {}
+
+// Move every entry of the chain into a new tree, the chain nodes go back to the pool
+template <typename T1, typename T2>
+void HybridBucket<T1, T2>::treeify()
+{
+	tree_.reset(new AVL<T1, TreeValue>());
+
+	AVL<T1, TreeValue>* tree = tree_.get();
+	list_.drain([tree](T1&& key, T2&& value, const StoredHash<T1>& stored) { tree->emplace(std::move(key), std::move(value), stored.storedHash()); });
+}
+
+// Move every entry of the tree back into the chain, in key order
+template <typename T1, typename T2>
+void HybridBucket<T1, T2>::untreeify()
+{
+	SinglyLinkedList<T1, T2>& list = list_;
+	tree_->drain([&list](T1&& key, TreeValue&& entry) { list.pushBack(std::move(key), std::move(entry.value), entry.storedHash()); });
+
+	tree_.reset();
+}
+
+// Add an entry, turning the chain into a tree if it is already at the threshold. Rvalues are moved into the node
+template <typename T1, typename T2>
+template <typename K, typename V>
+void HybridBucket<T1, T2>::pushBack(K&& key, V&& value, uint64_t hashValue)
+{
+	if (!tree_ && list_.getSize() >= TREEIFY_THRESHOLD)
+		treeify();
+
+	if (tree_)
+		tree_->emplace(std::forward<K>(key), std::forward<V>(value), hashValue);
+	else
+		list_.pushBack(std::forward<K>(key), std::forward<V>(value), hashValue);
+}
+
+// Return a pointer to the value stored with the key, or nullptr. The key may be of any type
+// comparable to T1 with == and <
+template <typename T1, typename T2>
+template <typename K>
+T2* HybridBucket<T1, T2>::findValue(const K& key, uint64_t hashValue)
+{
+	if (tree_)
+	{
+		TreeValue* entry = tree_->find(key);
+		return entry != nullptr ? &entry->value : nullptr;
+	}
+
+	return list_.findValue(key, hashValue);
+}
+
+// Start loading the first node of the chain. Trees are left alone, they only grow in buckets crowded
+// by badly hashed keys
+template <typename T1, typename T2>
+void HybridBucket<T1, T2>::prefetch() const
+{
+	if (!tree_)
+		list_.prefetch();
+}
+
+// Remove the entry with the key, turning a tree that got small back into a chain.
+// Returns false if the key is not there
+template <typename T1, typename T2>
+template <typename K>
+bool HybridBucket<T1, T2>::erase(const K& key, uint64_t hashValue)
+{
+	if (!tree_)
+		return list_.erase(key, hashValue);
+
+	if (!tree_->tryRemove(key))
+		return false;
+
+	if (tree_->getSize() < UNTREEIFY_THRESHOLD)
+		untreeify();
+
+	return true;
+}
+
+// Forget the chain nodes without returning them to the pool, see SinglyLinkedList::release.
+// Tree nodes do not come from the pool and are freed as usual
+template <typename T1, typename T2>
+void HybridBucket<T1, T2>::release()
+{
+	list_.release();
+	tree_.reset();
+}
+
+template <typename T1, typename T2>
+void HybridBucket<T1, T2>::clear()
+{
+	list_.clear();
+	tree_.reset();
+}
+
+// Call function(key, value) for every entry
+template <typename T1, typename T2>
+template <typename Function>
+void HybridBucket<T1, T2>::forEach(Function function) const
+{
+	if (tree_)
+		tree_->forEach([&function](const T1& key, const TreeValue& entry) { function(key, entry.value); });
+	else
+		list_.forEach(function);
+}
+
+// Call function(key, value, storedHash) for every entry, handing over the key and the value as rvalues.
+// The bucket is empty afterwards
+template <typename T1, typename T2>
+template <typename Function>
+void HybridBucket<T1, T2>::drain(Function function)
+{
+	if (tree_)
+	{
+		tree_->drain([&function](T1&& key, TreeValue&& entry) { function(std::move(key), std::move(entry.value), static_cast<const StoredHash<T1>&>(entry)); });
+		tree_.reset();
+	}
+	else
+		list_.drain(function);
+}
+
+template <typename T1, typename T2>
+int HybridBucket<T1, T2>::getSize() const
+{
+	return tree_ ? tree_->getSize() : list_.getSize();
+}
+
+template <typename T1, typename T2>
+bool HybridBucket<T1, T2>::isEmpty() const
+{
+	return getSize() == 0;
+}
+
+template <typename T1, typename T2>
+bool HybridBucket<T1, T2>::isTree() const
+{
+	return tree_ != nullptr;
+}
+
+// Display every entry, a tree in key order between brackets
+template <typename T1, typename T2>
+void HybridBucket<T1, T2>::show() const
+{
+	if (!tree_)
+	{
+		list_.show();
+		return;
+	}
+
+	std::cout << "[ ";
+	tree_->forEach([](const T1& key, const TreeValue& entry) { std::cout << "{ " << key << ", " << entry.value << " } "; });
+	std::cout << "]\n";
+}
+
+#endif
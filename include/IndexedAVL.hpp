@@ -0,0 +1,321 @@
+#ifndef INDEXED_AVL_HPP
+#define INDEXED_AVL_HPP
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "HashTable.hpp"
+
+// Node of the indexed AVL tree. Children are 32 bit positions in the arena instead of pointers and the
+// height fits in a byte, so an int/int node takes 20 bytes instead of the 32 of an AVLNode
+template <typename T1, typename T2>
+struct IndexedAVLNode {
+	T1 key;
+	T2 value;
+	uint32_t left;
+	uint32_t right;
+	uint8_t height;
+};
+
+// AVL tree whose nodes live in one contiguous arena. Nodes refer to each other by index, a removed
+// node goes on a free list threaded through its left index and is reused by the next insert.
+// Destroying the tree frees the arena in one piece
+template <typename T1, typename T2>
+class IndexedAVL : public HashTable<T1, T2> {
+private:
+	static const uint32_t NIL = UINT32_MAX;		// Index of a missing child
+
+	std::vector<IndexedAVLNode<T1, T2>> nodes;	// Arena holding every node, live or free
+	uint32_t root;
+	uint32_t freeList;				// First free node of the arena, NIL if there is none
+	int size;					// Number of live nodes
+
+	int height(uint32_t node) const;
+	int balanceFactor(uint32_t node) const;
+	void updateHeight(uint32_t node);
+	uint32_t rotateRight(uint32_t node);
+	uint32_t rotateLeft(uint32_t node);
+	uint32_t balance(uint32_t node);
+	uint32_t createNode(T1&& key, T2&& value);
+	void destroyNode(uint32_t node);
+	uint32_t insert(uint32_t node, T1&& key, T2&& value);
+	uint32_t findMin(uint32_t node) const;
+	uint32_t removeMin(uint32_t node);
+	uint32_t remove(uint32_t node, const T1& key);
+	uint32_t findNode(const T1& key) const;
+
+public:
+	IndexedAVL(int capacity = 0);
+
+	void insert(T1 key, T2 value) override;
+	void remove(T1 key) override;
+
+	T2* find(const T1& key) override;
+	bool tryRemove(const T1& key) override;
+	void clear();
+	int getSize() const;
+
+	template <typename Function>
+	void forEach(Function function) const;
+};
+
+// Constructor, reserves room for the given number of nodes
+template<typename T1, typename T2>
+IndexedAVL<T1, T2>::IndexedAVL(int capacity) : root(NIL), freeList(NIL), size(0) {
+	if (capacity > 0) {
+		nodes.reserve(capacity);
+	}
+}
+
+// Function to get the height of a node, 0 for a missing one
+template<typename T1, typename T2>
+int IndexedAVL<T1, T2>::height(uint32_t node) const {
+	return node != NIL ? nodes[node].height : 0;
+}
+
+// Function to calculate the balance factor of a node
+template<typename T1, typename T2>
+int IndexedAVL<T1, T2>::balanceFactor(uint32_t node) const {
+	return height(nodes[node].right) - height(nodes[node].left);
+}
+
+// Function to update the height of a node
+template<typename T1, typename T2>
+void IndexedAVL<T1, T2>::updateHeight(uint32_t node) {
+	int hl = height(nodes[node].left);
+	int hr = height(nodes[node].right);
+	nodes[node].height = static_cast<uint8_t>((hl > hr ? hl : hr) + 1);
+}
+
+// Function to perform a right rotation, returns the new root of the subtree
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::rotateRight(uint32_t node) {
+	uint32_t left = nodes[node].left;
+	nodes[node].left = nodes[left].right;
+	nodes[left].right = node;
+	updateHeight(node);
+	updateHeight(left);
+	return left;
+}
+
+// Function to perform a left rotation, returns the new root of the subtree
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::rotateLeft(uint32_t node) {
+	uint32_t right = nodes[node].right;
+	nodes[node].right = nodes[right].left;
+	nodes[right].left = node;
+	updateHeight(node);
+	updateHeight(right);
+	return right;
+}
+
+// Function to balance a node
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::balance(uint32_t node) {
+	updateHeight(node);
+	// Right heavy
+	if (balanceFactor(node) == 2) {
+		// Right-Left case
+		if (balanceFactor(nodes[node].right) < 0) {
+			nodes[node].right = rotateRight(nodes[node].right);
+		}
+		return rotateLeft(node);
+	}
+	// Left heavy
+	if (balanceFactor(node) == -2) {
+		// Left-Right case
+		if (balanceFactor(nodes[node].left) > 0) {
+			nodes[node].left = rotateLeft(nodes[node].left);
+		}
+		return rotateRight(node);
+	}
+	return node;
+}
+
+// Function to take a node from the free list, or from the end of the arena, and move the pair into it
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::createNode(T1&& key, T2&& value) {
+	uint32_t node = freeList;
+	if (node != NIL) {
+		freeList = nodes[node].left;
+	}
+	else {
+		if (nodes.size() >= NIL) {
+			throw std::length_error("Tree is full");
+		}
+		node = static_cast<uint32_t>(nodes.size());
+		nodes.emplace_back();
+	}
+	nodes[node].key = std::move(key);
+	nodes[node].value = std::move(value);
+	nodes[node].left = NIL;
+	nodes[node].right = NIL;
+	nodes[node].height = 1;
+	size++;
+	return node;
+}
+
+// Function to put a node on the free list
+template<typename T1, typename T2>
+void IndexedAVL<T1, T2>::destroyNode(uint32_t node) {
+	// Drop the key and value now, for types that own memory
+	nodes[node].key = T1();
+	nodes[node].value = T2();
+	nodes[node].left = freeList;
+	freeList = node;
+	size--;
+}
+
+// Function to insert a key-value pair into the subtree, returns its new root.
+// The arena may grow on the way down, so nodes are only accessed by index
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::insert(uint32_t node, T1&& key, T2&& value) {
+	if (node == NIL) {
+		return createNode(std::move(key), std::move(value));
+	}
+	if (key < nodes[node].key) {
+		uint32_t left = insert(nodes[node].left, std::move(key), std::move(value));
+		nodes[node].left = left;
+	}
+	else if (nodes[node].key < key) {
+		uint32_t right = insert(nodes[node].right, std::move(key), std::move(value));
+		nodes[node].right = right;
+	}
+	else {
+		// If the key already exists, return the node
+		return node;
+	}
+	return balance(node);
+}
+
+// Function to find the node with the minimum key in the subtree
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::findMin(uint32_t node) const {
+	while (nodes[node].left != NIL) {
+		node = nodes[node].left;
+	}
+	return node;
+}
+
+// Function to unlink the node with the minimum key from the subtree, returns its new root
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::removeMin(uint32_t node) {
+	if (nodes[node].left == NIL) {
+		return nodes[node].right;
+	}
+	nodes[node].left = removeMin(nodes[node].left);
+	return balance(node);
+}
+
+// Function to remove a key from the subtree, returns its new root
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::remove(uint32_t node, const T1& key) {
+	if (node == NIL) {
+		return NIL;
+	}
+	if (key < nodes[node].key) {
+		nodes[node].left = remove(nodes[node].left, key);
+	}
+	else if (nodes[node].key < key) {
+		nodes[node].right = remove(nodes[node].right, key);
+	}
+	else {
+		uint32_t left = nodes[node].left;
+		uint32_t right = nodes[node].right;
+		destroyNode(node);
+		if (right == NIL) {
+			return left;
+		}
+		// The minimum of the right subtree takes the place of the removed node
+		uint32_t min = findMin(right);
+		nodes[min].right = removeMin(right);
+		nodes[min].left = left;
+		return balance(min);
+	}
+	return balance(node);
+}
+
+// Function to find the node holding the key, NIL if there is none
+template<typename T1, typename T2>
+uint32_t IndexedAVL<T1, T2>::findNode(const T1& key) const {
+	uint32_t node = root;
+	while (node != NIL) {
+		if (key < nodes[node].key) {
+			node = nodes[node].left;
+		}
+		else if (nodes[node].key < key) {
+			node = nodes[node].right;
+		}
+		else {
+			return node;
+		}
+	}
+	return NIL;
+}
+
+// Function to insert a key-value pair into the tree
+template<typename T1, typename T2>
+void IndexedAVL<T1, T2>::insert(T1 key, T2 value) {
+	root = insert(root, std::move(key), std::move(value));
+}
+
+// Function to remove a key-value pair from the tree
+template<typename T1, typename T2>
+void IndexedAVL<T1, T2>::remove(T1 key) {
+	root = remove(root, key);
+}
+
+// Function to get a pointer to the value stored with the key, or nullptr if there is none.
+// The pointer is valid until the next insert
+template<typename T1, typename T2>
+T2* IndexedAVL<T1, T2>::find(const T1& key) {
+	uint32_t node = findNode(key);
+	return node != NIL ? &nodes[node].value : nullptr;
+}
+
+// Function to remove a key, returns false if the key is not in the tree
+template<typename T1, typename T2>
+bool IndexedAVL<T1, T2>::tryRemove(const T1& key) {
+	int oldSize = size;
+	root = remove(root, key);
+	return size < oldSize;
+}
+
+// Function to remove every node at once, the arena keeps its memory for reuse
+template<typename T1, typename T2>
+void IndexedAVL<T1, T2>::clear() {
+	nodes.clear();
+	root = NIL;
+	freeList = NIL;
+	size = 0;
+}
+
+// Function to get the number of nodes
+template<typename T1, typename T2>
+int IndexedAVL<T1, T2>::getSize() const {
+	return size;
+}
+
+// Function to call function(key, value) for every node, in key order
+template<typename T1, typename T2>
+template<typename Function>
+void IndexedAVL<T1, T2>::forEach(Function function) const {
+	std::vector<uint32_t> stack;
+	uint32_t node = root;
+	while (node != NIL || !stack.empty()) {
+		// Go down to the leftmost node not visited yet
+		while (node != NIL) {
+			stack.push_back(node);
+			node = nodes[node].left;
+		}
+		node = stack.back();
+		stack.pop_back();
+		function(nodes[node].key, nodes[node].value);
+		node = nodes[node].right;
+	}
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef LOCK_FREE_CHAINING_TABLE_HPP
+#define LOCK_FREE_CHAINING_TABLE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
+#include "EpochReclamation.hpp"
+
+// Separate chaining table whose chains are lock-free linked lists in the style of Harris, for any key and
+// value type. A chain is sorted by the hash stored in every node, so an insert knows where the key would
+// be and links its node there with one compare-and-swap on the link before it.
+// Removal is done in two steps: setting the low bit of the next link of a node marks it deleted, and any
+// operation that walks past a marked node swings the link before it over the node. Marked links can no
+// longer be changed, so no insert is ever lost behind a removed node. The thread whose swing succeeds
+// retires the node to the epoch domain, which deletes it once no running operation can still read it.
+// Readers only load links: they skip marked nodes and never wait for writers.
+// The number of buckets is fixed at construction, chains get longer as the table fills
+template <typename T1, typename T2, typename Hash = Hasher<T1>, typename Range = ModuloRange>
+class LockFreeChainingTable
+{
+private:
+	// Key and value never change once the node is linked, readers copy them without synchronization
+	struct Node
+	{
+		uint64_t hashValue;
+		T1 key;
+		T2 value;
+		std::atomic<uintptr_t> next;	// Address of the next node, bit 0 set once this node is removed
+
+		template <typename K, typename V>
+		Node(uint64_t hashValue, K&& key, V&& value) : hashValue(hashValue), key(std::forward<K>(key)), value(std::forward<V>(value)), next(0) {}
+	};
+
+	std::unique_ptr<std::atomic<uintptr_t>[]> buckets_;	// First node of every chain
+	size_t size_;						// Number of buckets
+	mutable EpochDomain epochs_;
+
+	static constexpr uintptr_t MARK = 1;
+
+	static Node* pointer(uintptr_t link);
+	static bool isMarked(uintptr_t link);
+
+	uint64_t hash(const T1& key) const;
+	bool search(EpochDomain::Guard& guard, const T1& key, uint64_t hashValue, std::atomic<uintptr_t>*& previous, Node*& current);
+	const Node* findNode(const T1& key, uint64_t hashValue) const;
+
+	LockFreeChainingTable(const LockFreeChainingTable&) = delete;
+	LockFreeChainingTable& operator=(const LockFreeChainingTable&) = delete;
+
+public:
+	LockFreeChainingTable(size_t size);
+	~LockFreeChainingTable();
+
+	bool insert(T1 key, T2 value);
+	bool find(const T1& key, T2& value) const;
+	bool contains(const T1& key) const;
+	bool tryRemove(const T1& key);
+
+	size_t getBucketCount() const;
+};
+
+template <typename T1, typename T2, typename Hash, typename Range>
+LockFreeChainingTable<T1, T2, Hash, Range>::LockFreeChainingTable(size_t size) : size_(Range::capacity(size))
+{
+	if (size == 0)
+		throw std::invalid_argument("Table size must be positive");
+
+	buckets_.reset(new std::atomic<uintptr_t>[size_]);
+
+	for (size_t i = 0; i < size_; i++)
+		buckets_[i].store(0, std::memory_order_relaxed);
+}
+
+// Delete every node still linked, removed nodes not yet freed belong to the epoch domain.
+// No operation may be running
+template <typename T1, typename T2, typename Hash, typename Range>
+LockFreeChainingTable<T1, T2, Hash, Range>::~LockFreeChainingTable()
+{
+	for (size_t i = 0; i < size_; i++)
+	{
+		Node* node = pointer(buckets_[i].load(std::memory_order_relaxed));
+
+		while (node != nullptr)
+		{
+			Node* next = pointer(node->next.load(std::memory_order_relaxed));
+			delete node;
+			node = next;
+		}
+	}
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+typename LockFreeChainingTable<T1, T2, Hash, Range>::Node* LockFreeChainingTable<T1, T2, Hash, Range>::pointer(uintptr_t link)
+{
+	return reinterpret_cast<Node*>(link & ~MARK);
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeChainingTable<T1, T2, Hash, Range>::isMarked(uintptr_t link)
+{
+	return (link & MARK) != 0;
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+uint64_t LockFreeChainingTable<T1, T2, Hash, Range>::hash(const T1& key) const
+{
+	Hash hashFunction;
+
+	return hashFunction(key);
+}
+
+// Walk the chain of the key, unlinking marked nodes on the way. Returns true with current at the node of
+// the key, or false with current at the first node of a greater hash (nullptr at the end). Either way
+// previous is the link that points to current
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeChainingTable<T1, T2, Hash, Range>::search(EpochDomain::Guard& guard, const T1& key, uint64_t hashValue, std::atomic<uintptr_t>*& previous, Node*& current)
+{
+restart:
+	previous = &buckets_[Range::reduce(hashValue, size_)];
+	current = pointer(previous->load(std::memory_order_acquire));
+
+	while (current != nullptr)
+	{
+		uintptr_t next = current->next.load(std::memory_order_acquire);
+
+		if (isMarked(next))
+		{
+			// Swing the link over the removed node, the link changed under us if this fails
+			uintptr_t expected = reinterpret_cast<uintptr_t>(current);
+
+			if (!previous->compare_exchange_strong(expected, next & ~MARK, std::memory_order_acq_rel, std::memory_order_acquire))
+				goto restart;
+
+			guard.retire(current);
+			current = pointer(next);
+			continue;
+		}
+
+		if (current->hashValue > hashValue)
+			return false;
+
+		if (current->hashValue == hashValue && current->key == key)
+			return true;
+
+		previous = &current->next;
+		current = pointer(next);
+	}
+
+	return false;
+}
+
+// Insert the pair if the key is not there, return whether it was inserted.
+// Two inserts of the same key race on the same link, the loser finds the key when it searches again
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeChainingTable<T1, T2, Hash, Range>::insert(T1 key, T2 value)
+{
+	EpochDomain::Guard guard(epochs_);
+	uint64_t hashValue = hash(key);
+	std::unique_ptr<Node> node(new Node(hashValue, std::move(key), std::move(value)));
+	std::atomic<uintptr_t>* previous;
+	Node* current;
+
+	while (true)
+	{
+		if (search(guard, node->key, hashValue, previous, current))
+			return false;
+
+		uintptr_t expected = reinterpret_cast<uintptr_t>(current);
+		node->next.store(expected, std::memory_order_relaxed);
+
+		if (previous->compare_exchange_strong(expected, reinterpret_cast<uintptr_t>(node.get()), std::memory_order_release, std::memory_order_relaxed))
+		{
+			node.release();
+			return true;
+		}
+	}
+}
+
+// Return the node of the key if it is not removed, or nullptr. Only loads links, removed nodes are skipped
+// but not unlinked. The caller holds a guard for as long as it uses the node
+template <typename T1, typename T2, typename Hash, typename Range>
+const typename LockFreeChainingTable<T1, T2, Hash, Range>::Node* LockFreeChainingTable<T1, T2, Hash, Range>::findNode(const T1& key, uint64_t hashValue) const
+{
+	const Node* node = pointer(buckets_[Range::reduce(hashValue, size_)].load(std::memory_order_acquire));
+
+	while (node != nullptr && node->hashValue <= hashValue)
+	{
+		uintptr_t next = node->next.load(std::memory_order_acquire);
+
+		if (!isMarked(next) && node->hashValue == hashValue && node->key == key)
+			return node;
+
+		node = pointer(next);
+	}
+
+	return nullptr;
+}
+
+// Copy the value of the key into value, return false if the key is not there
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeChainingTable<T1, T2, Hash, Range>::find(const T1& key, T2& value) const
+{
+	EpochDomain::Guard guard(epochs_);
+	const Node* node = findNode(key, hash(key));
+
+	if (node == nullptr)
+		return false;
+
+	value = node->value;
+	return true;
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeChainingTable<T1, T2, Hash, Range>::contains(const T1& key) const
+{
+	EpochDomain::Guard guard(epochs_);
+
+	return findNode(key, hash(key)) != nullptr;
+}
+
+// Remove the key, return whether it was there. Marking the node is what removes it, unlinking it is left
+// to the next walk along the chain if the first attempt fails
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeChainingTable<T1, T2, Hash, Range>::tryRemove(const T1& key)
+{
+	EpochDomain::Guard guard(epochs_);
+	uint64_t hashValue = hash(key);
+	std::atomic<uintptr_t>* previous;
+	Node* current;
+
+	if (!search(guard, key, hashValue, previous, current))
+		return false;
+
+	uintptr_t next = current->next.load(std::memory_order_acquire);
+
+	while (!isMarked(next))
+	{
+		// On failure next holds the link an insert or a removal after the node put there
+		if (current->next.compare_exchange_weak(next, next | MARK, std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			uintptr_t expected = reinterpret_cast<uintptr_t>(current);
+
+			if (previous->compare_exchange_strong(expected, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+				guard.retire(current);
+			else
+				search(guard, key, hashValue, previous, current);
+
+			return true;
+		}
+	}
+
+	// Another thread removed the key first
+	return false;
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t LockFreeChainingTable<T1, T2, Hash, Range>::getBucketCount() const
+{
+	return size_;
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef LOCK_FREE_OPEN_ADDRESSING_TABLE_HPP
+#define LOCK_FREE_OPEN_ADDRESSING_TABLE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
+
+// Concurrent linear probing table for keys and values of up to 64 bits that are trivially copyable,
+// such as int, long long or pointers. Every slot is a key word and a value word, both atomic, so no
+// operation takes a lock:
+//  - insert claims a free slot by swapping its key word from EMPTY_WORD to the key with compare-and-swap,
+//    then publishes the value with a second compare-and-swap on the value word
+//  - a key never leaves its slot once claimed. Removing it swaps its value word back to EMPTY_WORD, and
+//    inserting the key again reuses the slot, so the capacity bounds the number of distinct keys ever inserted
+//  - readers only load words and stop at the key or at the first unclaimed slot, so they are wait-free
+// Keys and values are compared bitwise. The all ones 64 bit pattern marks an empty word and cannot be
+// stored as a 64 bit key or value; narrower types are zero extended and never reach it
+template <typename T1, typename T2, typename Hash = Hasher<T1>, typename Range = PowerOfTwoRange>
+class LockFreeOpenAddressingTable
+{
+private:
+	static_assert(std::is_trivially_copyable<T1>::value && sizeof(T1) <= 8, "Keys must be trivially copyable and at most 64 bits");
+	static_assert(std::is_trivially_copyable<T2>::value && sizeof(T2) <= 8, "Values must be trivially copyable and at most 64 bits");
+
+	static constexpr uint64_t EMPTY_WORD = ~uint64_t(0);
+
+	struct Slot
+	{
+		std::atomic<uint64_t> key{ EMPTY_WORD };
+		std::atomic<uint64_t> value{ EMPTY_WORD };
+	};
+
+	std::unique_ptr<Slot[]> slots_;
+	size_t capacity_;
+
+	template <typename T>
+	static uint64_t encode(const T& item);
+	template <typename T>
+	static T decode(uint64_t word);
+
+	size_t firstSlot(const T1& key) const;
+	Slot* findSlot(const T1& key) const;
+	Slot* claimSlot(const T1& key);
+
+	LockFreeOpenAddressingTable(const LockFreeOpenAddressingTable&) = delete;
+	LockFreeOpenAddressingTable& operator=(const LockFreeOpenAddressingTable&) = delete;
+
+public:
+	LockFreeOpenAddressingTable(size_t capacity);
+
+	bool insert(const T1& key, const T2& value);
+	void insertOrAssign(const T1& key, const T2& value);
+	T2 add(const T1& key, T2 delta);
+	bool find(const T1& key, T2& value) const;
+	bool contains(const T1& key) const;
+	bool tryRemove(const T1& key);
+
+	size_t getCapacity() const;
+};
+
+// The range policy may round the capacity up
+template <typename T1, typename T2, typename Hash, typename Range>
+LockFreeOpenAddressingTable<T1, T2, Hash, Range>::LockFreeOpenAddressingTable(size_t capacity) : capacity_(Range::capacity(capacity))
+{
+	if (capacity == 0)
+		throw std::invalid_argument("Table size must be positive");
+
+	slots_.reset(new Slot[capacity_]);
+}
+
+// Copy the bits of a key or value into the low bytes of a word
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename T>
+uint64_t LockFreeOpenAddressingTable<T1, T2, Hash, Range>::encode(const T& item)
+{
+	uint64_t word = 0;
+	std::memcpy(&word, &item, sizeof(T));
+
+	if (word == EMPTY_WORD)
+		throw std::invalid_argument("The all ones 64 bit pattern is reserved");
+
+	return word;
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename T>
+T LockFreeOpenAddressingTable<T1, T2, Hash, Range>::decode(uint64_t word)
+{
+	T item;
+	std::memcpy(&item, &word, sizeof(T));
+	return item;
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t LockFreeOpenAddressingTable<T1, T2, Hash, Range>::firstSlot(const T1& key) const
+{
+	Hash hashFunction;
+
+	return Range::reduce(hashFunction(key), capacity_);
+}
+
+// Return the slot claimed by the key, or nullptr. Wait-free: at most one pass over the table
+template <typename T1, typename T2, typename Hash, typename Range>
+typename LockFreeOpenAddressingTable<T1, T2, Hash, Range>::Slot* LockFreeOpenAddressingTable<T1, T2, Hash, Range>::findSlot(const T1& key) const
+{
+	uint64_t keyWord = encode(key);
+	size_t index = firstSlot(key);
+
+	for (size_t probes = 0; probes < capacity_; probes++)
+	{
+		uint64_t probed = slots_[index].key.load(std::memory_order_acquire);
+
+		if (probed == keyWord)
+			return &slots_[index];
+
+		// Keys are claimed front to back along a probe chain, the key would be before this slot
+		if (probed == EMPTY_WORD)
+			return nullptr;
+
+		index = Range::next(index, capacity_);
+	}
+
+	return nullptr;
+}
+
+// Return the slot of the key, claiming the first free one on its probe chain if it has none.
+// Two threads claiming the same key race on the same slot and the loser finds the key there
+template <typename T1, typename T2, typename Hash, typename Range>
+typename LockFreeOpenAddressingTable<T1, T2, Hash, Range>::Slot* LockFreeOpenAddressingTable<T1, T2, Hash, Range>::claimSlot(const T1& key)
+{
+	uint64_t keyWord = encode(key);
+	size_t index = firstSlot(key);
+
+	for (size_t probes = 0; probes < capacity_; probes++)
+	{
+		uint64_t probed = slots_[index].key.load(std::memory_order_acquire);
+
+		if (probed == EMPTY_WORD)
+		{
+			// On failure probed holds the key that won the slot
+			if (slots_[index].key.compare_exchange_strong(probed, keyWord, std::memory_order_acq_rel, std::memory_order_acquire))
+				return &slots_[index];
+		}
+
+		if (probed == keyWord)
+			return &slots_[index];
+
+		index = Range::next(index, capacity_);
+	}
+
+	throw std::out_of_range("Table is full");
+}
+
+// Insert the pair if the key is not there, return whether it was inserted
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeOpenAddressingTable<T1, T2, Hash, Range>::insert(const T1& key, const T2& value)
+{
+	uint64_t valueWord = encode(value);
+	uint64_t expected = EMPTY_WORD;
+
+	return claimSlot(key)->value.compare_exchange_strong(expected, valueWord, std::memory_order_release, std::memory_order_relaxed);
+}
+
+// Store the value with the key, whether or not the key was there
+template <typename T1, typename T2, typename Hash, typename Range>
+void LockFreeOpenAddressingTable<T1, T2, Hash, Range>::insertOrAssign(const T1& key, const T2& value)
+{
+	uint64_t valueWord = encode(value);
+
+	claimSlot(key)->value.store(valueWord, std::memory_order_release);
+}
+
+// Add delta to the value of the key, a missing key counts as zero. Returns the new value
+template <typename T1, typename T2, typename Hash, typename Range>
+T2 LockFreeOpenAddressingTable<T1, T2, Hash, Range>::add(const T1& key, T2 delta)
+{
+	static_assert(std::is_arithmetic<T2>::value, "add needs an arithmetic value type");
+
+	Slot* slot = claimSlot(key);
+	uint64_t current = slot->value.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		T2 sum = (current == EMPTY_WORD ? T2() : decode<T2>(current)) + delta;
+
+		// On failure current holds the value another thread stored in between
+		if (slot->value.compare_exchange_weak(current, encode(sum), std::memory_order_release, std::memory_order_relaxed))
+			return sum;
+	}
+}
+
+// Copy the value of the key into value, return false if the key is not there. Wait-free
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeOpenAddressingTable<T1, T2, Hash, Range>::find(const T1& key, T2& value) const
+{
+	Slot* slot = findSlot(key);
+
+	if (slot == nullptr)
+		return false;
+
+	uint64_t valueWord = slot->value.load(std::memory_order_acquire);
+
+	if (valueWord == EMPTY_WORD)
+		return false;
+
+	value = decode<T2>(valueWord);
+	return true;
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeOpenAddressingTable<T1, T2, Hash, Range>::contains(const T1& key) const
+{
+	Slot* slot = findSlot(key);
+
+	return slot != nullptr && slot->value.load(std::memory_order_acquire) != EMPTY_WORD;
+}
+
+// Remove the value of the key, the key keeps its slot. Return whether there was a value
+template <typename T1, typename T2, typename Hash, typename Range>
+bool LockFreeOpenAddressingTable<T1, T2, Hash, Range>::tryRemove(const T1& key)
+{
+	Slot* slot = findSlot(key);
+
+	if (slot == nullptr)
+		return false;
+
+	return slot->value.exchange(EMPTY_WORD, std::memory_order_acq_rel) != EMPTY_WORD;
+}
+
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t LockFreeOpenAddressingTable<T1, T2, Hash, Range>::getCapacity() const
+{
+	return capacity_;
+}
+
+#endif
@@ -2,11 +2,16 @@
 #define MENU_HPP
 
 #include <iostream>
+#include <memory>
 #include "HashTable.hpp"
 #include "OpenAddressingHashTable.hpp"
+#include "RobinHoodHashTable.hpp"
+#include "SwissHashTable.hpp"
 #include "ClosedAddressingTable.hpp"
-#include "Avl.hpp"
+#include "AVL.hpp"
+#include "BPlusTree.hpp"
 #include "CuckooHashingTable.hpp"
+#include "BucketizedCuckooTable.hpp"
 
 
 class Menu
@@ -23,12 +28,12 @@ class HashTableMenu : public Menu
 {
 protected: 
       std::unique_ptr<HashTable<T1, T2>> ht;
-      const int exitOption = 4;
+      const int exitOption = 9;
 public:
       void display() const override;
       void run() override;
 
-      template <typename T1, typename T2> friend class OperationMenu;
+      template <typename U1, typename U2> friend class OperationMenu;
 };
 
 template <typename T1, typename T2>
@@ -36,12 +41,12 @@ class OperationMenu : public Menu
 {
 protected:
       std::unique_ptr<HashTable<T1, T2>> ht;
-      const int exitOption = 3;
+      const int exitOption = 4;
 public:
     void display() const override;
     void run() override;
 
-    template <typename T1, typename T2> friend class HashTableMenu;
+    template <typename U1, typename U2> friend class HashTableMenu;
 };
 
 class DataTypeMenu : public Menu
@@ -62,7 +67,11 @@ void HashTableMenu<T1, T2>::display() const
       std::cout<<"2. Create a closed addressing hash table"<<std::endl;
       std::cout<<"3. Create an AVL tree-based hash table"<<std::endl;
       std::cout<<"4. Create a Cuckoo hashing table"<<std::endl;
-      std::cout<<"5. Exit program"<<std::endl;
+      std::cout<<"5. Create a Robin Hood hashing table"<<std::endl;
+      std::cout<<"6. Create a Swiss hashing table"<<std::endl;
+      std::cout<<"7. Create a bucketized Cuckoo hashing table"<<std::endl;
+      std::cout<<"8. Create a B+ tree-based hash table"<<std::endl;
+      std::cout<<"9. Exit program"<<std::endl;
       std::cout<<"--------------------------------------------"<<std::endl;
       std::cout<<"Choose one option from the menu:"<<std::endl;
 }
@@ -114,6 +123,42 @@ void HashTableMenu<T1, T2>::run()
                   }
 
                 case 5:
+                  {
+                    int size;
+                      std::cout << "Enter the size of the hash table: ";
+                      std::cin >> size;
+                      ht = std::make_unique<RobinHoodHashTable<T1,T2>>(size);
+                      break;
+                  }
+
+                case 6:
+                  {
+                    int size;
+                      std::cout << "Enter the size of the hash table: ";
+                      std::cin >> size;
+                      ht = std::make_unique<SwissHashTable<T1,T2>>(size);
+                      break;
+                  }
+
+                case 7:
+                  {
+                    int size;
+                      std::cout << "Enter the size of the hash table: ";
+                      std::cin >> size;
+                      ht = std::make_unique<BucketizedCuckooTable<T1,T2>>(size);
+                      break;
+                  }
+
+                case 8:
+                  {
+                    int size;
+                    std::cout << "Enter the size of the hash table: ";
+                    std::cin >> size;
+                    ht = std::make_unique<BPlusTree<T1,T2>>(size);
+                      break;
+                  }
+
+                case 9:
                   {
                     exit(0);
                     break;
@@ -149,7 +194,8 @@ void OperationMenu<T1, T2>::display() const
       std::cout<<"------ Operation Menu ------"<<std::endl;
       std::cout<<"1. Insert"<<std::endl;
       std::cout<<"2. Remove"<<std::endl;
-      std::cout<<"3. Exit structure menu"<<std::endl;
+      std::cout<<"3. Search"<<std::endl;
+      std::cout<<"4. Exit structure menu"<<std::endl;
       std::cout<<"----------------------------"<<std::endl;
       std::cout<<"Choose an operation to perform: "<<std::endl;
 }
@@ -181,11 +227,24 @@ void OperationMenu<T1, T2>::run()
             {
                 std::cout<<"Enter key to be removed: "<<std::endl;
                 std::cin>>key;
-                ht->remove(key);
+                if (!ht->tryRemove(key))
+                    std::cerr<<"error: key not found"<<std::endl;
                 break;
             }
-          
+
             case 3:
+            {
+                std::cout<<"Enter key to be found: "<<std::endl;
+                std::cin>>key;
+                T2* found = ht->find(key);
+                if (found)
+                    std::cout<<"Value: "<<*found<<std::endl;
+                else
+                    std::cout<<"Key not found"<<std::endl;
+                break;
+            }
+          
+            case 4:
             {
                 break;
             }
@@ -276,4 +335,4 @@ void DataTypeMenu::run()
 }
 
 
-#endif MENU_HPP
+#endif //MENU_HPP
@@ -1,14 +1,15 @@
 #ifndef NODE_HPP
 #define NODE_HPP
 
+// Key-value slot of the cuckoo tables. Whether a slot is in use is kept by the table, next to the
+// slots rather than in them, so a slot is only as big as its key and value
 template <typename T1, typename T2>
 struct Node
 {
 	T1 key;
 	T2 value;
-	bool isEmpty;
 
-	Node(): key(T1()), value(T2()), isEmpty(true) {}
+	Node(): key(T1()), value(T2()) {}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef NODE_POOL_HPP
+#define NODE_POOL_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#define MAX_SLAB_NODES 4096 // Upper bound on the number of nodes in one slab
+
+// Slab allocator for list and tree nodes. Nodes are carved out of slabs that grow geometrically,
+// so a million nodes cost a few dozen allocations and neighbouring nodes share cache lines.
+// A freed node goes on an intrusive free list stored in its own memory and is reused first.
+// release() drops every slab at once, it is up to the owner to run destructors before that
+template <typename T>
+class NodePool
+{
+private:
+	// A slot holds either a live node or the link to the next free slot
+	union Slot
+	{
+		Slot* next;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	std::vector<Slot*> slabs_;
+	Slot* freeList_;	// Most recently freed slot
+	size_t slabSize_;	// Number of slots in the newest slab
+	size_t used_;		// Number of slots handed out from the newest slab
+
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+public:
+	NodePool(size_t slabSize = 64);
+	~NodePool();
+
+	T* allocate();
+	void deallocate(T* node);
+	void release();
+};
+
+template <typename T>
+NodePool<T>::NodePool(size_t slabSize) : freeList_(nullptr), slabSize_(slabSize > 0 ? slabSize : 1), used_(slabSize_)
+{
+
+}
+
+template <typename T>
+NodePool<T>::~NodePool()
+{
+	release();
+}
+
+// Return a default constructed node, from the free list if possible
+template <typename T>
+T* NodePool<T>::allocate()
+{
+	Slot* slot = freeList_;
+
+	if (slot != nullptr)
+	{
+		freeList_ = slot->next;
+	}
+
+	else
+	{
+		// Start a new slab, twice as big as the previous one
+		if (used_ == slabSize_)
+		{
+			if (!slabs_.empty() && slabSize_ < MAX_SLAB_NODES)
+				slabSize_ *= 2;
+
+			slabs_.push_back(new Slot[slabSize_]);
+			used_ = 0;
+		}
+
+		slot = &slabs_.back()[used_++];
+	}
+
+	return new (slot->storage) T();
+}
+
+// Destroy the node and put its slot on the free list
+template <typename T>
+void NodePool<T>::deallocate(T* node)
+{
+	node->~T();
+
+	Slot* slot = reinterpret_cast<Slot*>(node);
+	slot->next = freeList_;
+	freeList_ = slot;
+}
+
+// Free every slab without running destructors
+template <typename T>
+void NodePool<T>::release()
+{
+	for (size_t i = 0; i < slabs_.size(); i++)
+		delete[] slabs_[i];
+
+	slabs_.clear();
+	freeList_ = nullptr;
+	used_ = slabSize_;
+}
+
+#endif
@@ -5,100 +5,331 @@
 #include <vector>
 #include <functional>
 #include <stdexcept>
+#include <limits>
+#include <utility>
 
 #include "HashTable.hpp"
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
+#include "SlotBitmap.hpp"
+#include "Prefetch.hpp"
 
 // Define a template class for open addressing hash table
-template <typename T1, typename T2>
+template <typename T1, typename T2, typename Hash = Hasher<T1>, typename Range = ModuloRange>
 class OpenAddressingTable : public HashTable<T1,T2> {
 
 private:
 // Define a structure to represent each entry in the hash table
-	struct HashEntry {
+	// The hash of the key is stored with it for keys that are not scalars, see StoredHash.
+	// The state of a slot lives in the bitmaps below, so an int/int entry takes 8 bytes
+	struct HashEntry : StoredHash<T1> {
 		T1 key;
 		T2 value;
-		bool isDeleted;
-		bool isOccupied;
-
-		// Constructor to initialize entry flags
-		HashEntry() : isDeleted(false), isOccupied(false) {}
 	};
-	
+
 	std::vector<HashEntry> table;		// Vector to hold hash table entries
+	SlotBitmap occupiedSlots;		// Slots holding an entry or a tombstone
+	SlotBitmap deletedSlots;		// Slots holding a tombstone
 	int size;				// Current number of elements in the table
 	int capacity;				// Total capacity of the table
+	int used;				// Number of occupied slots in the table, tombstones included
+	int deleted;				// Number of tombstones in the table
+
+	// Growth mode: the table is moved into a bigger (or tombstone free) one a few slots at a time
+	bool autoGrow;				// Whether the table grows instead of reporting it is full
+	float maxLoadFactor;			// Maximum ratio of used slots (tombstones included) to capacity
+	std::vector<HashEntry> oldTable;	// Table being migrated from, empty if no migration is in progress
+	SlotBitmap oldOccupiedSlots;		// Occupied slots of the old table
+	SlotBitmap oldDeletedSlots;		// Tombstones of the old table
+	int oldCapacity;			// Capacity of the table being migrated from
+	int oldSize;				// Number of elements still waiting in the old table
+	int migrateIndex;			// Slot of the old table to look for the next live entry from
+
+	static const int MIGRATION_STEP = 4;	// Number of old entries migrated by every insert and remove
 
 	// Private member function to calculate hash value for a given key
-	int hash(const T1& key);
+	template <typename K>
+	uint64_t hash(const K& key);
 
+	template <typename K>
+	int findIndex(std::vector<HashEntry>& entries, const SlotBitmap& used, const SlotBitmap& tombstones, int entriesCapacity, const K& key, uint64_t hashValue);	// Function to find the slot holding a key
+	template <typename K>
+	T2* lookup(const K& key, uint64_t hashValue);		// Function to find the value associated with a key in both tables
+	template <typename K>
+	bool erase(const K& key, uint64_t hashValue);		// Function to remove a key from whichever table holds it
+	void insertHashed(T1&& key, T2&& value, uint64_t hashValue);	// Function to insert a key-value pair whose key is hashed already
+	void prefetch(uint64_t hashValue);			// Function to start loading the home slot of a hash
+	template <typename Operation>
+	void forEachBatch(const T1* keys, size_t count, Operation operation);	// Function to run an operation over an array of keys with prefetching
+	void place(T1&& key, T2&& value, uint64_t hashValue);	// Function to put an entry known to be absent into the table
+	void startMigration();					// Function to start moving entries into a new table
+	void migrate(int steps);				// Function to move a number of old entries into the new table
 
 public:
-	OpenAddressingTable(int tableSize);				// Constructor
-	OpenAddressingTable(const OpenAddressingTable<T1,T2>& copy);	// Copy constructor
+	OpenAddressingTable(int tableSize, bool autoGrow = false, float maxLoadFactor = 0.75f);	// Constructor, the range policy may round the capacity up
+	OpenAddressingTable(const OpenAddressingTable<T1,T2,Hash,Range>& copy);	// Copy constructor
 	~OpenAddressingTable();						// Destructor
 	void insert(T1 key, T2 value) override;				// Function to insert a key-value pair
-	void remove(T1 key) override;					// Function to remove a key-value pair
-	T2 search(T1 key);						// Function to search for a value associated with a key
+	void remove(T1 key) override;					// Function to remove a key-value pair, throws if it is not there
+	T2* find(const T1& key) override;				// Function to find the value associated with a key, nullptr if there is none
+	bool tryRemove(const T1& key) override;				// Function to remove a key-value pair, returns false if it is not there
+
+	// Batched versions of find, insert and tryRemove that overlap the cache misses of a batch of keys
+	void findBatch(const T1* keys, size_t count, T2** values) override;
+	void insertBatch(const T1* keys, const T2* values, size_t count) override;
+	size_t removeBatch(const T1* keys, size_t count) override;
+
+	// Lookups with any key type a transparent hasher accepts, e.g. std::string_view for std::string keys
+	using HashTable<T1,T2>::contains;
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	T2* find(const K& key) { return lookup(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const K& key) { return lookup(key, hash(key)) != nullptr; }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool tryRemove(const K& key) { return erase(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	void remove(const K& key);
 };
 
-// Implementation of hash function
-template <typename T1, typename T2>
-int OpenAddressingTable<T1,T2>::hash(const T1& key) {
-	std::hash<T1> hashFunction;
-	return hashFunction(key) % capacity;
+// Implementation of hash function, the range policy reduces the result to a slot of a table
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+uint64_t OpenAddressingTable<T1,T2,Hash,Range>::hash(const K& key) {
+	Hash hashFunction;
+	return hashFunction(key);
 }
 
 // Constructor
-template <typename T1, typename T2>
-OpenAddressingTable<T1,T2>::OpenAddressingTable(int tableSize): size(0), capacity(tableSize) {
-	table.resize(tableSize);
+template <typename T1, typename T2, typename Hash, typename Range>
+OpenAddressingTable<T1,T2,Hash,Range>::OpenAddressingTable(int tableSize, bool autoGrow, float maxLoadFactor)
+	: size(0), capacity(0), used(0), deleted(0), autoGrow(autoGrow), maxLoadFactor(maxLoadFactor),
+	  oldCapacity(0), oldSize(0), migrateIndex(0) {
+	if (tableSize <= 0) {
+		throw std::invalid_argument("Table size must be positive");
+	}
+	if (maxLoadFactor <= 0.0f || maxLoadFactor > 1.0f) {
+		throw std::invalid_argument("Maximum load factor must be in (0, 1]");
+	}
+	// The size is checked first, a negative one would turn into a huge request for the range policy
+	size_t rounded = Range::capacity(static_cast<size_t>(tableSize));
+	if (rounded > static_cast<size_t>(std::numeric_limits<int>::max())) {
+		throw std::length_error("Table size is too large");
+	}
+	capacity = static_cast<int>(rounded);
+	table.resize(capacity);
+	occupiedSlots.resize(capacity);
+	deletedSlots.resize(capacity);
 }
 
 // Copy constructor
-template <typename T1, typename T2>
-OpenAddressingTable<T1, T2>::OpenAddressingTable(const OpenAddressingTable<T1, T2>& copy)
+template <typename T1, typename T2, typename Hash, typename Range>
+OpenAddressingTable<T1, T2, Hash, Range>::OpenAddressingTable(const OpenAddressingTable<T1, T2, Hash, Range>& copy)
 {
 	this->size = copy.size;
 	this->capacity = copy.capacity;
 	this->table = copy.table;
+	this->occupiedSlots = copy.occupiedSlots;
+	this->deletedSlots = copy.deletedSlots;
+	this->used = copy.used;
+	this->deleted = copy.deleted;
+	this->autoGrow = copy.autoGrow;
+	this->maxLoadFactor = copy.maxLoadFactor;
+	this->oldTable = copy.oldTable;
+	this->oldOccupiedSlots = copy.oldOccupiedSlots;
+	this->oldDeletedSlots = copy.oldDeletedSlots;
+	this->oldCapacity = copy.oldCapacity;
+	this->oldSize = copy.oldSize;
+	this->migrateIndex = copy.migrateIndex;
 }
 
 
 // Destructor
-template <typename T1, typename T2>
-OpenAddressingTable<T1,T2>::~OpenAddressingTable() {
+template <typename T1, typename T2, typename Hash, typename Range>
+OpenAddressingTable<T1,T2,Hash,Range>::~OpenAddressingTable() {
 	table.clear();
 }
 
+// Function to find the slot holding a key, returns -1 if the key is not there.
+// Keys are compared only in slots whose stored hash is the hash of the key
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+int OpenAddressingTable<T1,T2,Hash,Range>::findIndex(std::vector<HashEntry>& entries, const SlotBitmap& used, const SlotBitmap& tombstones, int entriesCapacity, const K& key, uint64_t hashValue) {
+	int index = static_cast<int>(Range::reduce(hashValue, entriesCapacity));
+	int start_index = index;
+
+	// Linear probing until a never occupied slot is reached
+	while (used.test(index)) {
+		if (!tombstones.test(index) && entries[index].hashMatches(hashValue) && entries[index].key == key) {
+			return index;
+		}
+		index = static_cast<int>(Range::next(index, entriesCapacity));		// Move to the next slot
+		if (index == start_index) {
+			break;
+		}
+	}
+
+	return -1;
+}
+
+// Function to put an entry into the table, the caller makes sure the key is absent and a slot is free
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::place(T1&& key, T2&& value, uint64_t hashValue) {
+	int index = static_cast<int>(Range::reduce(hashValue, capacity));
+
+	// Take the first never occupied slot or tombstone
+	while (occupiedSlots.test(index) && !deletedSlots.test(index)) {
+		index = static_cast<int>(Range::next(index, capacity));
+	}
+
+	if (deletedSlots.test(index)) {
+		deletedSlots.reset(index);
+		deleted--;
+	}
+	else {
+		occupiedSlots.set(index);
+		used++;
+	}
+
+	table[index].key = std::move(key);
+	table[index].value = std::move(value);
+	table[index].setHash(hashValue);
+}
+
+// Function to start a migration. The current table becomes the old one and a new one is allocated:
+// twice as big if live entries fill it, of the same size if it is mostly tombstones
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::startMigration() {
+	int newCapacity = capacity;
+	if (size * 2 >= maxLoadFactor * capacity) {
+		newCapacity = capacity * 2;
+	}
+
+	oldTable.swap(table);
+	oldOccupiedSlots.swap(occupiedSlots);
+	oldDeletedSlots.swap(deletedSlots);
+	oldCapacity = capacity;
+	oldSize = size;
+	migrateIndex = 0;
+
+	std::vector<HashEntry>(newCapacity).swap(table);
+	SlotBitmap(newCapacity).swap(occupiedSlots);
+	SlotBitmap(newCapacity).swap(deletedSlots);
+	capacity = newCapacity;
+	used = 0;
+	deleted = 0;
+}
+
+// Function to move a number of old entries into the new table. Empty slots and tombstones are skipped
+// a bitmap word at a time
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::migrate(int steps) {
+	if (oldCapacity == 0) {
+		return;
+	}
+
+	while (steps > 0 && oldSize > 0) {
+		migrateIndex = static_cast<int>(oldOccupiedSlots.findNextExcept(migrateIndex, oldDeletedSlots));
+		if (migrateIndex == oldCapacity) {
+			break;
+		}
+		HashEntry& entry = oldTable[migrateIndex];
+		// The stored hash saves hashing the key again
+		uint64_t hashValue = entry.getHash(entry.key, Hash());
+		place(std::move(entry.key), std::move(entry.value), hashValue);
+		// Leave a tombstone behind so probe chains in the old table stay intact
+		oldDeletedSlots.set(migrateIndex);
+		oldSize--;
+		migrateIndex++;
+		steps--;
+	}
+
+	// Release the old table once everything has been moved
+	if (oldSize == 0 || migrateIndex == oldCapacity) {
+		std::vector<HashEntry>().swap(oldTable);
+		SlotBitmap().swap(oldOccupiedSlots);
+		SlotBitmap().swap(oldDeletedSlots);
+		oldCapacity = 0;
+		oldSize = 0;
+		migrateIndex = 0;
+	}
+}
+
+// Function to start loading the home slot of a hash, so that a batch of keys waits for all of its
+// cache misses at once. The bitmaps are 64 times smaller than the slots and mostly stay in the cache,
+// prefetching their words as well only takes line fill buffers away from the slots
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::prefetch(uint64_t hashValue) {
+	prefetchLine(&table[Range::reduce(hashValue, capacity)]);
+}
+
 // Function to insert a key-value pair into the hash table
-template <typename T1, typename T2>
-void OpenAddressingTable<T1,T2>::insert(T1 key, T2 value) {
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::insert(T1 key, T2 value) {
+	uint64_t hashValue = hash(key);		// Calculate the hash value for the key
+	insertHashed(std::move(key), std::move(value), hashValue);
+}
+
+// Function to insert a key-value pair, hashValue is the hash of the key
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::insertHashed(T1&& key, T2&& value, uint64_t hashValue) {
+	if (autoGrow) {
+		migrate(MIGRATION_STEP);
+
+		// Grow (or purge tombstones) once used slots would exceed the maximum load factor
+		if (used + 1 > maxLoadFactor * capacity) {
+			migrate(oldCapacity);
+			startMigration();
+		}
+
+		// Check if the key already waits in the old table
+		if (oldCapacity != 0 && findIndex(oldTable, oldOccupiedSlots, oldDeletedSlots, oldCapacity, key, hashValue) != -1) {
+			throw std::invalid_argument("Key already exists");
+		}
+	}
 	// Check if the table is full
-	if (size == capacity) {
+	else if (size == capacity) {
 		throw std::out_of_range("Table is full");
 	}
-	
-	int index = hash(key);		// Calculate the hash value for the key
+
+	int index = static_cast<int>(Range::reduce(hashValue, capacity));
 	int start_index = index;
+	int tombstone = -1;			// First deleted slot on the way, reused if the key is absent
 
-	// Linear probing to find an empty slot or a slot with deleted entry
-	while (table[index].isOccupied && !table[index].isDeleted) {
+	// Linear probing to the first never occupied slot, checking the whole chain for the key
+	while (occupiedSlots.test(index)) {
+		if (deletedSlots.test(index)) {
+			if (tombstone == -1) {
+				tombstone = index;
+			}
+		}
 		// Check if the key already exists
-		if (table[index].key == key )
-			{
+		else if (table[index].hashMatches(hashValue) && table[index].key == key) {
 			throw std::invalid_argument("Key already exists");
 		}
-		index = (index + 1) % capacity;		// Move to the next slot
+		index = static_cast<int>(Range::next(index, capacity));		// Move to the next slot
 		// Check if we have traversed the entire table without finding an empty slot
 		if (index == start_index) {
-			throw std::out_of_range("Table is full");
+			if (tombstone == -1) {
+				throw std::out_of_range("Table is full");
+			}
+			break;
 		}
 	}
+
+	if (tombstone != -1) {
+		index = tombstone;
+		deletedSlots.reset(index);
+		deleted--;
+	}
+	else {
+		occupiedSlots.set(index);
+		used++;
+	}
+
 	// Insert the key-value pair into the table
-	table[index].key = key;
-	table[index].value = value;
-	table[index].isOccupied = true;
-	table[index].isDeleted = false;
+	table[index].key = std::move(key);
+	table[index].value = std::move(value);
+	table[index].setHash(hashValue);
 	// Increment the size of the table
 	size++;
 
@@ -106,57 +337,135 @@ void OpenAddressingTable<T1,T2>::insert(T1 key, T2 value) {
 }
 
 // Function to remove a key-value pair from the hash table
-template <typename T1, typename T2>
-void OpenAddressingTable<T1,T2>::remove(T1 key) {
-	int index = hash(key);		// Calculate the hash value for the key
-	int start_index = index;
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::remove(T1 key) {
+	if (!tryRemove(key)) {
+		// Key not found
+		throw std::out_of_range("Key not found");
+	}
+}
+
+// Function to remove a key-value pair with a compatible key, throws if it is not there
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K, typename H, typename>
+void OpenAddressingTable<T1,T2,Hash,Range>::remove(const K& key) {
+	if (!erase(key, hash(key))) {
+		throw std::out_of_range("Key not found");
+	}
+}
 
-	// Linear probing to find the key
-	while (table[index].isOccupied) {
-		 // Check if the current entry matches the key and is not marked as deleted
-		if (table[index].key == key && !table[index].isDeleted) {
-			table[index].isDeleted = true;		// Mark the entry as deleted
-			//std::cout << "Removed key: " << key << " from index: " << index << "\n";
-			// Decrement the size of the table
+// Function to remove a key-value pair if it is in the hash table
+template <typename T1, typename T2, typename Hash, typename Range>
+bool OpenAddressingTable<T1,T2,Hash,Range>::tryRemove(const T1& key) {
+	return erase(key, hash(key));
+}
+
+// Function to remove a key from the new table or from the old one, returns false if it is in neither
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+bool OpenAddressingTable<T1,T2,Hash,Range>::erase(const K& key, uint64_t hashValue) {
+	if (autoGrow) {
+		migrate(MIGRATION_STEP);
+	}
+
+	int index = findIndex(table, occupiedSlots, deletedSlots, capacity, key, hashValue);
+	if (index != -1) {
+		deletedSlots.set(index);		// Mark the entry as deleted
+		//std::cout << "Removed key: " << key << " from index: " << index << "\n";
+		deleted++;
+		// Decrement the size of the table
+		size--;
+		return true;
+	}
+
+	// The key may still be waiting in the old table
+	if (oldCapacity != 0) {
+		index = findIndex(oldTable, oldOccupiedSlots, oldDeletedSlots, oldCapacity, key, hashValue);
+		if (index != -1) {
+			oldDeletedSlots.set(index);
+			oldSize--;
 			size--;
-			return;
+			return true;
 		}
-		index = (index + 1) % capacity;		// Move to the next slot
-		 // Check if we have traversed the entire table without finding the key
-		if (index == start_index) {
-			break;
+	}
+
+	// Key not found
+	return false;
+}
+
+// Function to find the value associated with a key in the hash table
+template <typename T1, typename T2, typename Hash, typename Range>
+T2* OpenAddressingTable<T1,T2,Hash,Range>::find(const T1& key) {
+	return lookup(key, hash(key));
+}
+
+// Function to find the value associated with a key in the new table or in the old one. Lookups do not
+// migrate: moving entries would free the old table under pointers returned by earlier lookups
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+T2* OpenAddressingTable<T1,T2,Hash,Range>::lookup(const K& key, uint64_t hashValue) {
+	int index = findIndex(table, occupiedSlots, deletedSlots, capacity, key, hashValue);
+	if (index != -1) {
+		//std::cout << "Found key: " << key << " at index: " << index << "\n";
+		// Return the value associated with the key
+		return &table[index].value;
+	}
+
+	// The key may still be waiting in the old table
+	if (oldCapacity != 0) {
+		index = findIndex(oldTable, oldOccupiedSlots, oldDeletedSlots, oldCapacity, key, hashValue);
+		if (index != -1) {
+			return &oldTable[index].value;
 		}
 	}
 
 	// Key not found
-	throw std::out_of_range("Key not found");
+	return nullptr;
 }
 
-// Function to search for a value associated with a key in the hash table
-template <typename T1, typename T2>
-T2 OpenAddressingTable<T1,T2>::search(T1 key) {
-	// Calculate the hash value for the key
-	int index = hash(key);
-	int start_index = index;
+// Function to call operation(i, hashValue) for every key, a batch of keys at a time. Every key of a batch
+// is hashed and its home slot prefetched before the first of them is resolved. An insert that grows the
+// table leaves the remaining prefetches of its batch pointing at the old slots, which only costs the misses
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename Operation>
+void OpenAddressingTable<T1,T2,Hash,Range>::forEachBatch(const T1* keys, size_t count, Operation operation) {
+	uint64_t hashes[PREFETCH_BATCH];
 
-	// Linear probing to find the key
-	while (table[index].isOccupied) {
-		// Check if the current entry matches the key and is not marked as deleted
-		if (table[index].key == key && !table[index].isDeleted) {
-			//std::cout << "Found key: " << key << " at index: " << index << "\n";
-			// Return the value associated with the key
-			return table[index].value;
+	for (size_t start = 0; start < count; start += PREFETCH_BATCH) {
+		size_t batch = count - start < PREFETCH_BATCH ? count - start : PREFETCH_BATCH;
+		for (size_t i = 0; i < batch; i++) {
+			hashes[i] = hash(keys[start + i]);
+			prefetch(hashes[i]);
 		}
-		index = (index + 1) % capacity;		// Move to the next slot
-		// Check if we have traversed the entire table without finding the key
-		if (index == start_index) {
-			throw std::out_of_range("Key not found");
-			break;
+		for (size_t i = 0; i < batch; i++) {
+			operation(start + i, hashes[i]);
 		}
 	}
+}
 
-	// Key not found
-	throw std::out_of_range("Key not found");
+// Function to find the values of an array of keys. Like find it does not migrate, so the pointers of
+// earlier keys of the array stay valid while later ones are resolved
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::findBatch(const T1* keys, size_t count, T2** values) {
+	forEachBatch(keys, count, [this, keys, values](size_t i, uint64_t hashValue) { values[i] = lookup(keys[i], hashValue); });
+}
+
+// Function to insert an array of key-value pairs
+template <typename T1, typename T2, typename Hash, typename Range>
+void OpenAddressingTable<T1,T2,Hash,Range>::insertBatch(const T1* keys, const T2* values, size_t count) {
+	forEachBatch(keys, count, [this, keys, values](size_t i, uint64_t hashValue) { insertHashed(T1(keys[i]), T2(values[i]), hashValue); });
+}
+
+// Function to remove an array of keys, returns the number of keys that were there
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t OpenAddressingTable<T1,T2,Hash,Range>::removeBatch(const T1* keys, size_t count) {
+	size_t removed = 0;
+	forEachBatch(keys, count, [this, keys, &removed](size_t i, uint64_t hashValue) {
+		if (erase(keys[i], hashValue)) {
+			removed++;
+		}
+	});
+	return removed;
 }
 
 #endif //OPENHASH_TABLE_HPP
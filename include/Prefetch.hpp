@@ -0,0 +1,25 @@
+#ifndef PREFETCH_HPP
+#define PREFETCH_HPP
+
+#define PREFETCH_BATCH 16	// Number of keys of a batch hashed and prefetched before the first of them is resolved
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+// Start loading the cache line holding address without waiting for it. Only a hint: the address does
+// not need to be valid and nothing happens where the compiler has no prefetch instruction.
+// Batched operations prefetch the slots of all keys of a batch first, so their cache misses overlap
+// instead of being paid one after another
+inline void prefetchLine(const void* address)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+	(void)address;
+#endif
+}
+
+#endif
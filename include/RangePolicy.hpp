@@ -0,0 +1,93 @@
+#ifndef RANGE_POLICY_HPP
+#define RANGE_POLICY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Policies mapping a 64 bit hash to a slot or bucket index. A table takes the policy as a template
+// parameter and uses it for three things: rounding the requested capacity, reducing a hash to an
+// index, and stepping to the next slot in a linear probe. None of them divides except ModuloRange::reduce
+
+// Plain modulo, works with any capacity. Costs an integer division per reduction
+struct ModuloRange
+{
+	static size_t capacity(size_t requested)
+	{
+		return requested;
+	}
+
+	static size_t reduce(uint64_t hashValue, size_t capacity)
+	{
+		return static_cast<size_t>(hashValue % capacity);
+	}
+
+	static size_t next(size_t index, size_t capacity)
+	{
+		return index + 1 == capacity ? 0 : index + 1;
+	}
+};
+
+// Capacity rounded up to a power of two and reduced with a mask. The mask keeps only the low bits
+// of the hash, so it relies on a hasher that mixes every input bit into them, like Hasher
+struct PowerOfTwoRange
+{
+	// Throws std::length_error if no power of two of size_t is large enough
+	static size_t capacity(size_t requested)
+	{
+		const size_t largest = static_cast<size_t>(1) << (sizeof(size_t) * 8 - 1);
+
+		if (requested > largest)
+			throw std::length_error("Requested capacity has no power of two above it");
+
+		size_t capacity = 1;
+
+		while (capacity < requested)
+			capacity *= 2;
+
+		return capacity;
+	}
+
+	static size_t reduce(uint64_t hashValue, size_t capacity)
+	{
+		return static_cast<size_t>(hashValue) & (capacity - 1);
+	}
+
+	static size_t next(size_t index, size_t capacity)
+	{
+		return (index + 1) & (capacity - 1);
+	}
+};
+
+// Lemire's multiply-shift reduction: the high half of hash * capacity is uniform in [0, capacity)
+// for any capacity, and costs one multiplication. It uses the high bits of the hash
+struct FastRange
+{
+	static size_t capacity(size_t requested)
+	{
+		return requested;
+	}
+
+	static size_t reduce(uint64_t hashValue, size_t capacity)
+	{
+#if defined(__SIZEOF_INT128__)
+		return static_cast<size_t>((static_cast<__uint128_t>(hashValue) * capacity) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		return static_cast<size_t>(__umulh(hashValue, capacity));
+#else
+		// 32 bit reduction of the high half, capacities above 2^32 are not reachable here
+		return static_cast<size_t>(((hashValue >> 32) * static_cast<uint32_t>(capacity)) >> 32);
+#endif
+	}
+
+	static size_t next(size_t index, size_t capacity)
+	{
+		return index + 1 == capacity ? 0 : index + 1;
+	}
+};
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef ROBIN_HOOD_HASH_TABLE_HPP
+#define ROBIN_HOOD_HASH_TABLE_HPP
+
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <limits>
+
+#include "HashTable.hpp"
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
+#include "Prefetch.hpp"
+
+// Define a template class for open addressing hash table with Robin Hood linear probing.
+// Every slot remembers how far it is from its home slot. Entries that are far from home take
+// slots from entries that are closer, which keeps probe lengths short and even
+template <typename T1, typename T2, typename Hash = Hasher<T1>, typename Range = ModuloRange>
+class RobinHoodHashTable : public HashTable<T1,T2> {
+
+private:
+	// Define a structure to represent each entry in the hash table
+	struct HashEntry {
+		T1 key;
+		T2 value;
+		int distance;		// Distance from the home slot, -1 if the slot is empty
+
+		// Constructor to initialize an empty entry
+		HashEntry() : distance(-1) {}
+	};
+
+	std::vector<HashEntry> table;		// Vector to hold hash table entries
+	int size;				// Current number of elements in the table
+	int capacity;				// Total capacity of the table
+
+	// Private member function to calculate hash value for a given key
+	template <typename K>
+	int hash(const K& key);
+
+	template <typename K>
+	int findIndex(const K& key, int home);	// Function to find the slot holding a key whose home slot is home
+	template <typename K>
+	bool erase(const K& key, int home);	// Function to remove a key and shift the following entries back
+	void insertHashed(T1&& key, T2&& value, int home);	// Function to insert a key-value pair whose home slot is known
+	template <typename Operation>
+	void forEachBatch(const T1* keys, size_t count, Operation operation);	// Function to run an operation over an array of keys with prefetching
+
+public:
+	RobinHoodHashTable(int tableSize);				// Constructor, the range policy may round the capacity up
+	RobinHoodHashTable(const RobinHoodHashTable<T1,T2,Hash,Range>& copy);	// Copy constructor
+	~RobinHoodHashTable();						// Destructor
+	void insert(T1 key, T2 value) override;				// Function to insert a key-value pair
+	void remove(T1 key) override;					// Function to remove a key-value pair, throws if it is not there
+	T2* find(const T1& key) override;				// Function to find the value associated with a key, nullptr if there is none
+	bool tryRemove(const T1& key) override;				// Function to remove a key-value pair, returns false if it is not there
+
+	// Batched versions of find, insert and tryRemove that overlap the cache misses of a batch of keys
+	void findBatch(const T1* keys, size_t count, T2** values) override;
+	void insertBatch(const T1* keys, const T2* values, size_t count) override;
+	size_t removeBatch(const T1* keys, size_t count) override;
+
+	// Lookups with any key type a transparent hasher accepts, e.g. std::string_view for std::string keys
+	using HashTable<T1,T2>::contains;
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	T2* find(const K& key);
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const K& key) { return findIndex(key, hash(key)) != -1; }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool tryRemove(const K& key) { return erase(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	void remove(const K& key);
+};
+
+// Implementation of hash function
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+int RobinHoodHashTable<T1,T2,Hash,Range>::hash(const K& key) {
+	Hash hashFunction;
+	return static_cast<int>(Range::reduce(hashFunction(key), capacity));
+}
+
+// Constructor
+template <typename T1, typename T2, typename Hash, typename Range>
+RobinHoodHashTable<T1,T2,Hash,Range>::RobinHoodHashTable(int tableSize) : size(0), capacity(0) {
+	if (tableSize <= 0) {
+		throw std::invalid_argument("Table size must be positive");
+	}
+	// The size is checked first, a negative one would turn into a huge request for the range policy
+	size_t rounded = Range::capacity(static_cast<size_t>(tableSize));
+	if (rounded > static_cast<size_t>(std::numeric_limits<int>::max())) {
+		throw std::length_error("Table size is too large");
+	}
+	capacity = static_cast<int>(rounded);
+	table.resize(capacity);
+}
+
+// Copy constructor
+template <typename T1, typename T2, typename Hash, typename Range>
+RobinHoodHashTable<T1,T2,Hash,Range>::RobinHoodHashTable(const RobinHoodHashTable<T1,T2,Hash,Range>& copy)
+{
+	this->size = copy.size;
+	this->capacity = copy.capacity;
+	this->table = copy.table;
+}
+
+// Destructor
+template <typename T1, typename T2, typename Hash, typename Range>
+RobinHoodHashTable<T1,T2,Hash,Range>::~RobinHoodHashTable() {
+	table.clear();
+}
+
+// Function to find the slot holding a key, returns -1 if the key is not there.
+// The probe stops as soon as it meets an entry closer to home than the key would be
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+int RobinHoodHashTable<T1,T2,Hash,Range>::findIndex(const K& key, int home) {
+	int index = home;
+
+	for (int distance = 0; distance <= table[index].distance; distance++) {
+		if (table[index].key == key) {
+			return index;
+		}
+		index = static_cast<int>(Range::next(index, capacity));		// Move to the next slot
+	}
+
+	return -1;
+}
+
+// Function to insert a key-value pair into the hash table
+template <typename T1, typename T2, typename Hash, typename Range>
+void RobinHoodHashTable<T1,T2,Hash,Range>::insert(T1 key, T2 value) {
+	int home = hash(key);		// Calculate the hash value for the key
+	insertHashed(std::move(key), std::move(value), home);
+}
+
+// Function to insert a key-value pair starting from the home slot of the key
+template <typename T1, typename T2, typename Hash, typename Range>
+void RobinHoodHashTable<T1,T2,Hash,Range>::insertHashed(T1&& key, T2&& value, int home) {
+	int index = home;
+	int distance = 0;
+
+	// Walk the run of entries that are at least as far from home as the key, looking for the key
+	while (table[index].distance >= distance) {
+		if (table[index].key == key) {
+			throw std::invalid_argument("Key already exists");
+		}
+		index = static_cast<int>(Range::next(index, capacity));
+		distance++;
+	}
+
+	// Check if the table is full
+	if (size == capacity) {
+		throw std::out_of_range("Table is full");
+	}
+
+	// Take the slot, and carry the richer entry that lived there further along
+	while (table[index].distance != -1) {
+		if (table[index].distance < distance) {
+			std::swap(key, table[index].key);
+			std::swap(value, table[index].value);
+			std::swap(distance, table[index].distance);
+		}
+		index = static_cast<int>(Range::next(index, capacity));
+		distance++;
+	}
+
+	// Insert the key-value pair into the empty slot
+	table[index].key = std::move(key);
+	table[index].value = std::move(value);
+	table[index].distance = distance;
+	// Increment the size of the table
+	size++;
+}
+
+// Function to remove a key-value pair from the hash table.
+// Entries after the removed one are shifted back by one slot, so no tombstones are left
+template <typename T1, typename T2, typename Hash, typename Range>
+void RobinHoodHashTable<T1,T2,Hash,Range>::remove(T1 key) {
+	if (!tryRemove(key)) {
+		// Key not found
+		throw std::out_of_range("Key not found");
+	}
+}
+
+// Function to remove a key-value pair with a compatible key, throws if it is not there
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K, typename H, typename>
+void RobinHoodHashTable<T1,T2,Hash,Range>::remove(const K& key) {
+	if (!erase(key, hash(key))) {
+		throw std::out_of_range("Key not found");
+	}
+}
+
+// Function to remove a key-value pair if it is in the hash table, see remove
+template <typename T1, typename T2, typename Hash, typename Range>
+bool RobinHoodHashTable<T1,T2,Hash,Range>::tryRemove(const T1& key) {
+	return erase(key, hash(key));
+}
+
+// Function to remove a key and shift back the entries after it, returns false if the key is not there
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K>
+bool RobinHoodHashTable<T1,T2,Hash,Range>::erase(const K& key, int home) {
+	int index = findIndex(key, home);
+	if (index == -1) {
+		return false;
+	}
+
+	int next = static_cast<int>(Range::next(index, capacity));
+
+	// Shift back every following entry that is not in its home slot
+	while (table[next].distance > 0) {
+		table[index].key = std::move(table[next].key);
+		table[index].value = std::move(table[next].value);
+		table[index].distance = table[next].distance - 1;
+		index = next;
+		next = static_cast<int>(Range::next(next, capacity));
+	}
+
+	table[index].key = T1();
+	table[index].value = T2();
+	table[index].distance = -1;
+	// Decrement the size of the table
+	size--;
+	return true;
+}
+
+// Function to find the value associated with a key in the hash table
+template <typename T1, typename T2, typename Hash, typename Range>
+T2* RobinHoodHashTable<T1,T2,Hash,Range>::find(const T1& key) {
+	int index = findIndex(key, hash(key));
+	if (index == -1) {
+		// Key not found
+		return nullptr;
+	}
+
+	// Return the value associated with the key
+	return &table[index].value;
+}
+
+// Function to find the value associated with a key of a compatible type
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename K, typename H, typename>
+T2* RobinHoodHashTable<T1,T2,Hash,Range>::find(const K& key) {
+	int index = findIndex(key, hash(key));
+	return index != -1 ? &table[index].value : nullptr;
+}
+
+// Function to call operation(i, home) for every key, a batch of keys at a time. The home slots of every
+// key of a batch are prefetched before the first of them is resolved, a probe rarely leaves the cache
+// line of its home slot
+template <typename T1, typename T2, typename Hash, typename Range>
+template <typename Operation>
+void RobinHoodHashTable<T1,T2,Hash,Range>::forEachBatch(const T1* keys, size_t count, Operation operation) {
+	int homes[PREFETCH_BATCH];
+
+	for (size_t start = 0; start < count; start += PREFETCH_BATCH) {
+		size_t batch = count - start < PREFETCH_BATCH ? count - start : PREFETCH_BATCH;
+		for (size_t i = 0; i < batch; i++) {
+			homes[i] = hash(keys[start + i]);
+			prefetchLine(&table[homes[i]]);
+		}
+		for (size_t i = 0; i < batch; i++) {
+			operation(start + i, homes[i]);
+		}
+	}
+}
+
+// Function to find the values of an array of keys
+template <typename T1, typename T2, typename Hash, typename Range>
+void RobinHoodHashTable<T1,T2,Hash,Range>::findBatch(const T1* keys, size_t count, T2** values) {
+	forEachBatch(keys, count, [this, keys, values](size_t i, int home) {
+		int index = findIndex(keys[i], home);
+		values[i] = index != -1 ? &table[index].value : nullptr;
+	});
+}
+
+// Function to insert an array of key-value pairs
+template <typename T1, typename T2, typename Hash, typename Range>
+void RobinHoodHashTable<T1,T2,Hash,Range>::insertBatch(const T1* keys, const T2* values, size_t count) {
+	forEachBatch(keys, count, [this, keys, values](size_t i, int home) { insertHashed(T1(keys[i]), T2(values[i]), home); });
+}
+
+// Function to remove an array of keys, returns the number of keys that were there
+template <typename T1, typename T2, typename Hash, typename Range>
+size_t RobinHoodHashTable<T1,T2,Hash,Range>::removeBatch(const T1* keys, size_t count) {
+	size_t removed = 0;
+	forEachBatch(keys, count, [this, keys, &removed](size_t i, int home) {
+		if (erase(keys[i], home)) {
+			removed++;
+		}
+	});
+	return removed;
+}
+
+#endif //ROBIN_HOOD_HASH_TABLE_HPP
@@ -0,0 +1,240 @@
+#ifndef SHARDED_TABLE_HPP
+#define SHARDED_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "HashTable.hpp"
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
+
+#define SHARD_SEED 0x2545f4914f6cdd1dULL	// Seed of the hash that picks a shard
+
+// Thread safe table made of independent shards of any table type. The high bits of a separately seeded
+// hash of the key pick the shard, so the bits every shard indexes with stay uniform within it.
+// Each shard has its own reader-writer lock on a cache line of its own: operations on different shards
+// never wait for each other and do not bounce a shared line between cores.
+// find returns a pointer that another thread may invalidate as soon as the lock is released; concurrent
+// code reads through search, visit or contains and writes through update, tryEmplace or insertOrAssign,
+// which run entirely under the lock of the shard
+template <typename T1, typename T2, typename Table, typename Hash = Hasher<T1>>
+class ShardedTable : public HashTable<T1, T2>
+{
+private:
+	struct alignas(64) Shard
+	{
+		std::shared_mutex lock;
+		std::unique_ptr<Table> table;
+	};
+
+	typedef std::shared_lock<std::shared_mutex> ReadLock;		// Lookups leave every table type unchanged, readers share a shard
+	typedef std::unique_lock<std::shared_mutex> WriteLock;
+
+	std::unique_ptr<Shard[]> shards_;
+	size_t shardCount_;
+	int shardBits_;		// log2 of the number of shards
+
+	template <typename K>
+	Shard& shardOf(const K& key);
+
+public:
+	template <typename... Args>
+	ShardedTable(size_t shardCount, const Args&... args);
+	ShardedTable(const ShardedTable<T1, T2, Table, Hash>&) = delete;
+	ShardedTable<T1, T2, Table, Hash>& operator=(const ShardedTable<T1, T2, Table, Hash>&) = delete;
+
+	void insert(T1 key, T2 value) override;
+	void remove(T1 key) override;
+	T2* find(const T1& key) override;
+	bool tryRemove(const T1& key) override;
+
+	T2 search(const T1& key);
+	template <typename Function>
+	bool visit(const T1& key, Function function);
+	template <typename Function>
+	bool update(const T1& key, Function function);
+
+	template <typename K, typename... Args>
+	bool tryEmplace(K&& key, Args&&... args);
+	template <typename K, typename M>
+	bool insertOrAssign(K&& key, M&& value);
+
+	// Lookups with any key type a transparent hasher accepts, e.g. std::string_view for std::string keys
+	using HashTable<T1, T2>::contains;
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const K& key);
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool tryRemove(const K& key);
+
+	size_t getShardCount() const;
+};
+
+// Build the shards, every one constructed with the same arguments. The number of shards is rounded up
+// to a power of two
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename... Args>
+ShardedTable<T1, T2, Table, Hash>::ShardedTable(size_t shardCount, const Args&... args)
+	: shardCount_(PowerOfTwoRange::capacity(shardCount > 0 ? shardCount : 1)), shardBits_(0)
+{
+	while ((size_t(1) << shardBits_) < shardCount_)
+		shardBits_++;
+
+	shards_.reset(new Shard[shardCount_]);
+
+	for (size_t i = 0; i < shardCount_; i++)
+		shards_[i].table.reset(new Table(args...));
+}
+
+// Pick the shard of a key from the high bits of its routing hash
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename K>
+typename ShardedTable<T1, T2, Table, Hash>::Shard& ShardedTable<T1, T2, Table, Hash>::shardOf(const K& key)
+{
+	if (shardBits_ == 0)
+		return shards_[0];
+
+	Hash hashFunction;
+
+	return shards_[hashFunction(key, SHARD_SEED) >> (64 - shardBits_)];
+}
+
+template <typename T1, typename T2, typename Table, typename Hash>
+void ShardedTable<T1, T2, Table, Hash>::insert(T1 key, T2 value)
+{
+	Shard& shard = shardOf(key);
+	WriteLock lock(shard.lock);
+
+	shard.table->insert(std::move(key), std::move(value));
+}
+
+template <typename T1, typename T2, typename Table, typename Hash>
+void ShardedTable<T1, T2, Table, Hash>::remove(T1 key)
+{
+	Shard& shard = shardOf(key);
+	WriteLock lock(shard.lock);
+
+	shard.table->remove(std::move(key));
+}
+
+// Return a pointer to the value, only safe to use while no other thread writes to the table
+template <typename T1, typename T2, typename Table, typename Hash>
+T2* ShardedTable<T1, T2, Table, Hash>::find(const T1& key)
+{
+	Shard& shard = shardOf(key);
+	ReadLock lock(shard.lock);
+
+	return shard.table->find(key);
+}
+
+template <typename T1, typename T2, typename Table, typename Hash>
+bool ShardedTable<T1, T2, Table, Hash>::tryRemove(const T1& key)
+{
+	Shard& shard = shardOf(key);
+	WriteLock lock(shard.lock);
+
+	return shard.table->tryRemove(key);
+}
+
+// Return a copy of the value taken under the lock, throw if there is none
+template <typename T1, typename T2, typename Table, typename Hash>
+T2 ShardedTable<T1, T2, Table, Hash>::search(const T1& key)
+{
+	Shard& shard = shardOf(key);
+	ReadLock lock(shard.lock);
+
+	T2* value = shard.table->find(key);
+
+	if (value == nullptr)
+		throw std::out_of_range("Key not found");
+
+	return *value;
+}
+
+// Call function(const value&) under the read lock of the shard if the key is there, return whether it was
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename Function>
+bool ShardedTable<T1, T2, Table, Hash>::visit(const T1& key, Function function)
+{
+	Shard& shard = shardOf(key);
+	ReadLock lock(shard.lock);
+
+	T2* value = shard.table->find(key);
+
+	if (value == nullptr)
+		return false;
+
+	function(static_cast<const T2&>(*value));
+	return true;
+}
+
+// Call function(value&) under the write lock of the shard if the key is there, return whether it was
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename Function>
+bool ShardedTable<T1, T2, Table, Hash>::update(const T1& key, Function function)
+{
+	Shard& shard = shardOf(key);
+	WriteLock lock(shard.lock);
+
+	T2* value = shard.table->find(key);
+
+	if (value == nullptr)
+		return false;
+
+	function(*value);
+	return true;
+}
+
+// Insert the value only if the key is not there yet, the check and the insert happen under one lock
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename K, typename... Args>
+bool ShardedTable<T1, T2, Table, Hash>::tryEmplace(K&& key, Args&&... args)
+{
+	Shard& shard = shardOf(key);
+	WriteLock lock(shard.lock);
+
+	return shard.table->tryEmplace(std::forward<K>(key), std::forward<Args>(args)...);
+}
+
+// Assign the value to the key or insert the pair under one lock, return true if it was inserted
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename K, typename M>
+bool ShardedTable<T1, T2, Table, Hash>::insertOrAssign(K&& key, M&& value)
+{
+	Shard& shard = shardOf(key);
+	WriteLock lock(shard.lock);
+
+	return shard.table->insertOrAssign(std::forward<K>(key), std::forward<M>(value));
+}
+
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename K, typename H, typename>
+bool ShardedTable<T1, T2, Table, Hash>::contains(const K& key)
+{
+	Shard& shard = shardOf(key);
+	ReadLock lock(shard.lock);
+
+	return shard.table->contains(key);
+}
+
+template <typename T1, typename T2, typename Table, typename Hash>
+template <typename K, typename H, typename>
+bool ShardedTable<T1, T2, Table, Hash>::tryRemove(const K& key)
+{
+	Shard& shard = shardOf(key);
+	WriteLock lock(shard.lock);
+
+	return shard.table->tryRemove(key);
+}
+
+template <typename T1, typename T2, typename Table, typename Hash>
+size_t ShardedTable<T1, T2, Table, Hash>::getShardCount() const
+{
+	return shardCount_;
+}
+
+#endif
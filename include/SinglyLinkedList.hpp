@@ -5,32 +5,60 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <type_traits>
+#include <utility>
 
+#include "NodePool.hpp"
+#include "Hasher.hpp"
+#include "Prefetch.hpp"
+
+// The hash of the key is stored in the node for keys that are not scalars, see StoredHash
 template  <typename T1, typename T2>
-class SinglyNode
+class SinglyNode : public StoredHash<T1>
 {
 private:
 	T1 key_;
 	T2 value_;
 	SinglyNode<T1, T2>* next_;
-	template  <typename T1, typename T2> friend class SinglyLinkedList;
+	template  <typename U1, typename U2> friend class SinglyLinkedList;
 };
 
 template  <typename T1, typename T2>
 class SinglyLinkedList
 {
+public:
+	typedef NodePool<SinglyNode<T1, T2>> Pool;
+
 private:
 	SinglyNode<T1, T2>* head_;
 	SinglyNode<T1, T2>* tail_;
 	int size_;
 
+	// Nodes come from this pool if set, from new otherwise
+	NodePool<SinglyNode<T1, T2>>* pool_;
+
 	bool success_ = 1;
 
+	SinglyNode<T1, T2>* createNode();
+	void destroyNode(SinglyNode<T1, T2>* node);
+
 public:
-	SinglyLinkedList();
+	SinglyLinkedList(NodePool<SinglyNode<T1, T2>>* pool = nullptr);
+	SinglyLinkedList(SinglyLinkedList<T1, T2>&& other);
+	SinglyLinkedList(const SinglyLinkedList<T1, T2>&) = delete;
+	SinglyLinkedList<T1, T2>& operator=(const SinglyLinkedList<T1, T2>&) = delete;
 	~SinglyLinkedList();
 
-	void pushBack(const T1& key, const T2& value);
+	void release();
+	void clear();
+
+	template <typename Function>
+	void forEach(Function function) const;
+	template <typename Function>
+	void drain(Function function);
+
+	template <typename K, typename V>
+	void pushBack(K&& key, V&& value, uint64_t hashValue = 0);
 	void pushFront(const T1& key, const T2& value);
 	void insert(const T1& key, const T2& value, const int& index);
 
@@ -44,20 +72,114 @@ public:
 	void show() const;
 	bool isEmpty() const;
 	int find(const T1& key) const;
+	template <typename K>
+	T2* findValue(const K& key, uint64_t hashValue);
+	template <typename K>
+	bool erase(const K& key, uint64_t hashValue);
+	void prefetch() const;
 };
 
 
 // Create an empty list
 template  <typename T1, typename T2>
-SinglyLinkedList<T1, T2>::SinglyLinkedList() : head_(nullptr), tail_(nullptr), size_(0) {}
+SinglyLinkedList<T1, T2>::SinglyLinkedList(NodePool<SinglyNode<T1, T2>>* pool) : head_(nullptr), tail_(nullptr), size_(0), pool_(pool) {}
+
+// Take over the nodes of another list
+template  <typename T1, typename T2>
+SinglyLinkedList<T1, T2>::SinglyLinkedList(SinglyLinkedList<T1, T2>&& other) : head_(other.head_), tail_(other.tail_), size_(other.size_), pool_(other.pool_)
+{
+	other.head_ = nullptr;
+	other.tail_ = nullptr;
+	other.size_ = 0;
+}
 
 template  <typename T1, typename T2>
 SinglyLinkedList<T1, T2>::~SinglyLinkedList()
+{
+	clear();
+}
+
+// Remove every element, returning the nodes to where they came from
+template  <typename T1, typename T2>
+void SinglyLinkedList<T1, T2>::clear()
 {
 	while (!isEmpty())
 		popFront();
 }
 
+// Get a node from the pool or the heap
+template  <typename T1, typename T2>
+SinglyNode<T1, T2>* SinglyLinkedList<T1, T2>::createNode()
+{
+	if (pool_ != nullptr)
+		return pool_->allocate();
+
+	return new SinglyNode<T1, T2>;
+}
+
+// Give a node back to where it came from
+template  <typename T1, typename T2>
+void SinglyLinkedList<T1, T2>::destroyNode(SinglyNode<T1, T2>* node)
+{
+	if (pool_ != nullptr)
+		pool_->deallocate(node);
+	else
+		delete node;
+}
+
+// Forget every node without returning it, for pooled lists whose pool is about to free its slabs.
+// Destructors still run for keys and values that need them
+template  <typename T1, typename T2>
+void SinglyLinkedList<T1, T2>::release()
+{
+	if (pool_ == nullptr)
+		return;
+
+	if (!std::is_trivially_destructible<SinglyNode<T1, T2>>::value)
+	{
+		SinglyNode<T1, T2>* current_node = head_;
+
+		while (current_node != nullptr)
+		{
+			SinglyNode<T1, T2>* next_node = current_node->next_;
+			current_node->~SinglyNode<T1, T2>();
+			current_node = next_node;
+		}
+	}
+
+	head_ = nullptr;
+	tail_ = nullptr;
+	size_ = 0;
+}
+
+// Call function(key, value) for every element, front to back
+template  <typename T1, typename T2>
+template <typename Function>
+void SinglyLinkedList<T1, T2>::forEach(Function function) const
+{
+	for (SinglyNode<T1, T2>* current_node = head_; current_node != nullptr; current_node = current_node->next_)
+		function(current_node->key_, current_node->value_);
+}
+
+// Call function(key, value, storedHash) for every element front to back, handing over the key and the value
+// as rvalues, and remove the elements on the way. The list is empty afterwards
+template  <typename T1, typename T2>
+template <typename Function>
+void SinglyLinkedList<T1, T2>::drain(Function function)
+{
+	while (head_ != nullptr)
+	{
+		SinglyNode<T1, T2>* current_node = head_;
+		head_ = current_node->next_;
+
+		function(std::move(current_node->key_), std::move(current_node->value_), static_cast<const StoredHash<T1>&>(*current_node));
+		destroyNode(current_node);
+	}
+
+	tail_ = nullptr;
+	size_ = 0;
+}
+
 template  <typename T1, typename T2>
 bool SinglyLinkedList<T1, T2>::isEmpty() const
 {
@@ -76,7 +198,7 @@ int SinglyLinkedList<T1, T2>::getSize() const
 template  <typename T1, typename T2>
 void SinglyLinkedList<T1, T2>::pushFront(const T1& key, const T2& value)
 {
-	SinglyNode<T1, T2>* node = new SinglyNode<T1, T2>;
+	SinglyNode<T1, T2>* node = createNode();
 
 	node->value_ = value;
 	node->key_ = key;
@@ -92,28 +214,27 @@ void SinglyLinkedList<T1, T2>::pushFront(const T1& key, const T2& value)
 	size_ += 1;
 }
 
-// Add element to the back of the list
+// Add element to the back of the list. Key and value are forwarded, so rvalues are moved into the node.
+// The hash of the key is needed by lists used as buckets of a table, see findValue
 template  <typename T1, typename T2>
-void SinglyLinkedList<T1, T2>::pushBack(const T1& key, const T2& value)
+template <typename K, typename V>
+void SinglyLinkedList<T1, T2>::pushBack(K&& key, V&& value, uint64_t hashValue)
 {
-	if (this->isEmpty())
-	{
-		this->pushFront(key, value);
-	}
-
-	else
-	{
-		SinglyNode<T1, T2>* node = new SinglyNode<T1, T2>;
+	SinglyNode<T1, T2>* node = createNode();
 
-		node->value_ = value;
-		node->key_ = key;
-		node->next_ = nullptr;
+	node->value_ = std::forward<V>(value);
+	node->key_ = std::forward<K>(key);
+	node->setHash(hashValue);
+	node->next_ = nullptr;
 
+	if (this->isEmpty())
+		head_ = node;
+	else
 		tail_->next_ = node;
-		tail_ = node;
 
-		size_ += 1;
-	}
+	tail_ = node;
+
+	size_ += 1;
 }
 
 // Add element at specifed index
@@ -129,12 +250,12 @@ void SinglyLinkedList<T1, T2>::insert(const T1& key, const T2& value, const int&
 	}
 
 	if (index == 0)
-		this->pushFront(value);
+		this->pushFront(key, value);
 
 	else
 	{
 		SinglyNode<T1, T2>* current_node = head_;
-		SinglyNode<T1, T2>* new_node = new SinglyNode<T1, T2>;
+		SinglyNode<T1, T2>* new_node = createNode();
 
 		// get to the element at index-1 position
 		for (int i = 0; i < index - 1; i++)
@@ -167,7 +288,7 @@ void SinglyLinkedList<T1, T2>::popFront()
 	if (head_ == nullptr)
 		tail_ = temporary_node->next_;
 
-	delete temporary_node;
+	destroyNode(temporary_node);
 	size_ -= 1;
 }
 
@@ -198,7 +319,7 @@ void SinglyLinkedList<T1, T2>::popBack()
 		current_node->next_ = nullptr;
 		tail_ = current_node;
 
-		delete temporary_node;
+		destroyNode(temporary_node);
 		size_ -= 1;
 	}
 }
@@ -239,7 +360,7 @@ void SinglyLinkedList<T1, T2>::remove(const int& index)
 		temporary_node = current_node->next_;
 		current_node->next_ = current_node->next_->next_;
 
-		delete temporary_node;
+		destroyNode(temporary_node);
 		size_ -= 1;
 	}
 }
@@ -253,7 +374,7 @@ T2 SinglyLinkedList<T1, T2>::getValue(const int& index)
 	{
 		std::cerr << "error: index out of range\n";
 		this->success_ = 0;
-		return T{};
+		return T2{};
 	}
 
 	if (index == 0)
@@ -305,4 +426,58 @@ int SinglyLinkedList<T1, T2>::find(const T1& key) const
 	return -1;
 }
 
+// Start loading the first node, see prefetchLine
+template  <typename T1, typename T2>
+void SinglyLinkedList<T1, T2>::prefetch() const
+{
+	if (head_ != nullptr)
+		prefetchLine(head_);
+}
+
+// Return a pointer to the value of a first occurence of a specified key. In case of failure return nullptr.
+// The key may be of any type comparable to T1 with ==, it is compared only in nodes that store its hash
+template  <typename T1, typename T2>
+template <typename K>
+T2* SinglyLinkedList<T1, T2>::findValue(const K& key, uint64_t hashValue)
+{
+	for (SinglyNode<T1, T2>* current_node = head_; current_node != nullptr; current_node = current_node->next_)
+	{
+		if (current_node->hashMatches(hashValue) && current_node->key_ == key)
+			return &current_node->value_;
+	}
+
+	return nullptr;
+}
+
+// Delete a first occurence of a specified key, unlinking it in the same walk that finds it. Return false if there is none
+template  <typename T1, typename T2>
+template <typename K>
+bool SinglyLinkedList<T1, T2>::erase(const K& key, uint64_t hashValue)
+{
+	SinglyNode<T1, T2>* previous_node = nullptr;
+	SinglyNode<T1, T2>* current_node = head_;
+
+	while (current_node != nullptr && !(current_node->hashMatches(hashValue) && current_node->key_ == key))
+	{
+		previous_node = current_node;
+		current_node = current_node->next_;
+	}
+
+	if (current_node == nullptr)
+		return false;
+
+	if (previous_node == nullptr)
+		head_ = current_node->next_;
+	else
+		previous_node->next_ = current_node->next_;
+
+	if (tail_ == current_node)
+		tail_ = previous_node;
+
+	destroyNode(current_node);
+	size_ -= 1;
+
+	return true;
+}
+
 #endif
\ No newline at end of file
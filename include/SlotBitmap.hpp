@@ -0,0 +1,143 @@
+#ifndef SLOT_BITMAP_HPP
+#define SLOT_BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// One bit of state per slot of a table, packed 64 to a word and kept apart from the keys and values.
+// Slots stay as small as their key and value, and scans for set bits skip 64 empty slots per word
+class SlotBitmap
+{
+private:
+	std::vector<uint64_t> words_;
+	size_t size_;		// Number of bits
+
+	static size_t lowestBit(uint64_t word);
+
+public:
+	SlotBitmap(size_t size = 0);
+
+	bool test(size_t index) const;
+	void set(size_t index);
+	void reset(size_t index);
+
+	void resize(size_t size);
+	void clear();
+	void swap(SlotBitmap& other);
+
+	size_t findNext(size_t from) const;
+	size_t findNextExcept(size_t from, const SlotBitmap& other) const;
+	size_t size() const;
+};
+
+inline SlotBitmap::SlotBitmap(size_t size) : words_((size + 63) / 64, 0), size_(size) {}
+
+// Position of the lowest set bit of a non-zero word
+inline size_t SlotBitmap::lowestBit(uint64_t word)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long position;
+	_BitScanForward64(&position, word);
+	return position;
+#elif defined(_MSC_VER)
+	unsigned long position;
+	if (_BitScanForward(&position, static_cast<unsigned long>(word)))
+		return position;
+	_BitScanForward(&position, static_cast<unsigned long>(word >> 32));
+	return position + 32;
+#else
+	return static_cast<size_t>(__builtin_ctzll(word));
+#endif
+}
+
+inline bool SlotBitmap::test(size_t index) const
+{
+	return (words_[index / 64] >> (index % 64)) & 1;
+}
+
+inline void SlotBitmap::set(size_t index)
+{
+	words_[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+inline void SlotBitmap::reset(size_t index)
+{
+	words_[index / 64] &= ~(uint64_t(1) << (index % 64));
+}
+
+// Change the number of bits, bits below the new size keep their value and new bits are clear
+inline void SlotBitmap::resize(size_t size)
+{
+	if (size < size_ && size % 64 != 0)
+		words_[size / 64] &= (uint64_t(1) << (size % 64)) - 1;
+
+	words_.resize((size + 63) / 64, 0);
+	size_ = size;
+}
+
+// Clear every bit, one word at a time
+inline void SlotBitmap::clear()
+{
+	for (uint64_t& word : words_)
+		word = 0;
+}
+
+inline void SlotBitmap::swap(SlotBitmap& other)
+{
+	words_.swap(other.words_);
+	std::swap(size_, other.size_);
+}
+
+// Return the first set bit at or after from, or size() if there is none
+inline size_t SlotBitmap::findNext(size_t from) const
+{
+	if (from >= size_)
+		return size_;
+
+	size_t word = from / 64;
+	uint64_t bits = words_[word] & (~uint64_t(0) << (from % 64));
+
+	while (bits == 0)
+	{
+		if (++word == words_.size())
+			return size_;
+
+		bits = words_[word];
+	}
+
+	return word * 64 + lowestBit(bits);
+}
+
+// Return the first bit at or after from that is set here and clear in other, or size() if there is none.
+// Both bitmaps must have the same size
+inline size_t SlotBitmap::findNextExcept(size_t from, const SlotBitmap& other) const
+{
+	if (from >= size_)
+		return size_;
+
+	size_t word = from / 64;
+	uint64_t bits = words_[word] & ~other.words_[word] & (~uint64_t(0) << (from % 64));
+
+	while (bits == 0)
+	{
+		if (++word == words_.size())
+			return size_;
+
+		bits = words_[word] & ~other.words_[word];
+	}
+
+	return word * 64 + lowestBit(bits);
+}
+
+inline size_t SlotBitmap::size() const
+{
+	return size_;
+}
+
+#endif
@@ -0,0 +1,413 @@
+#ifndef SWISS_HASH_TABLE_HPP
+#define SWISS_HASH_TABLE_HPP
+
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWISS_TABLE_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "HashTable.hpp"
+#include "Hasher.hpp"
+#include "Prefetch.hpp"
+
+// Define a template class for open addressing hash table in the style of Swiss tables.
+// Next to the entries the table keeps one control byte per slot: the lowest 7 bits of the key hash
+// for a full slot, or a marker for an empty or deleted one. Slots are probed in groups of 16, and a
+// whole group of control bytes is compared at once (SSE2 when available, a scalar loop otherwise),
+// so keys are only compared when their 7 bit tags match
+template <typename T1, typename T2, typename Hash = Hasher<T1>>
+class SwissHashTable : public HashTable<T1,T2> {
+
+private:
+	// Define a structure to represent each entry in the hash table
+	struct HashEntry {
+		T1 key;
+		T2 value;
+	};
+
+	static constexpr int GROUP_SIZE = 16;		// Number of slots checked at once
+	static constexpr int8_t EMPTY = -128;		// Control byte of a never occupied slot
+	static constexpr int8_t DELETED = -2;		// Control byte of a removed entry
+
+	std::vector<int8_t> control;		// Control bytes, one per slot
+	std::vector<HashEntry> table;		// Vector to hold hash table entries
+	int size;				// Current number of elements in the table
+	int deleted;				// Number of deleted control bytes
+	int capacity;				// Total capacity of the table, a power of two multiple of GROUP_SIZE
+
+	// Private member function to calculate hash value for a given key
+	template <typename K>
+	size_t hash(const K& key);
+
+	static int lowestSlot(unsigned mask);	// Function to get the position of the lowest set bit of a group mask
+	unsigned match(int group, int8_t tag);	// Function to get a bit mask of slots in a group holding a control byte
+	unsigned matchFree(int group);		// Function to get a bit mask of empty or deleted slots in a group
+	template <typename K>
+	int findIndex(const K& key, size_t hashValue);	// Function to find the slot holding a key
+	template <typename K>
+	bool erase(const K& key, size_t hashValue);	// Function to remove a key, leaving an empty slot or a tombstone
+	void insertHashed(T1&& key, T2&& value, size_t hashValue);	// Function to insert a key-value pair whose key is hashed already
+	void place(T1&& key, T2&& value, size_t hashValue);	// Function to put an absent key into a free slot
+	void prefetchGroup(size_t hashValue);	// Function to start loading the control bytes of the first group probed for a hash
+	void prefetchEntry(size_t hashValue);	// Function to start loading the first entry of that group whose tag matches
+	template <typename Operation>
+	void forEachBatch(const T1* keys, size_t count, Operation operation);	// Function to run an operation over an array of keys with prefetching
+	void rehash(int newCapacity);		// Function to move every entry into a table of a new capacity
+
+public:
+	SwissHashTable(int tableSize);					// Constructor
+	SwissHashTable(const SwissHashTable<T1,T2,Hash>& copy);		// Copy constructor
+	~SwissHashTable();						// Destructor
+	void insert(T1 key, T2 value) override;				// Function to insert a key-value pair
+	void remove(T1 key) override;					// Function to remove a key-value pair, throws if it is not there
+	T2* find(const T1& key) override;				// Function to find the value associated with a key, nullptr if there is none
+	bool tryRemove(const T1& key) override;				// Function to remove a key-value pair, returns false if it is not there
+
+	// Batched versions of find, insert and tryRemove that overlap the cache misses of a batch of keys
+	void findBatch(const T1* keys, size_t count, T2** values) override;
+	void insertBatch(const T1* keys, const T2* values, size_t count) override;
+	size_t removeBatch(const T1* keys, size_t count) override;
+
+	// Lookups with any key type a transparent hasher accepts, e.g. std::string_view for std::string keys
+	using HashTable<T1,T2>::contains;
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	T2* find(const K& key);
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const K& key) { return findIndex(key, hash(key)) != -1; }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	bool tryRemove(const K& key) { return erase(key, hash(key)); }
+	template <typename K, typename H = Hash, typename = typename H::is_transparent>
+	void remove(const K& key);
+};
+
+// Implementation of hash function. The group index comes from the high bits and the tag from the
+// lowest 7 bits, so the hasher has to mix well
+template <typename T1, typename T2, typename Hash>
+template <typename K>
+size_t SwissHashTable<T1,T2,Hash>::hash(const K& key) {
+	Hash hashFunction;
+	return static_cast<size_t>(hashFunction(key));
+}
+
+// Constructor, the capacity is rounded up so that tableSize elements stay under 7/8 load
+template <typename T1, typename T2, typename Hash>
+SwissHashTable<T1,T2,Hash>::SwissHashTable(int tableSize) : size(0), deleted(0), capacity(GROUP_SIZE) {
+	if (tableSize <= 0) {
+		throw std::invalid_argument("Table size must be positive");
+	}
+	while (capacity / 8 * 7 < tableSize) {
+		capacity *= 2;
+	}
+	control.assign(capacity, EMPTY);
+	table.resize(capacity);
+}
+
+// Copy constructor
+template <typename T1, typename T2, typename Hash>
+SwissHashTable<T1,T2,Hash>::SwissHashTable(const SwissHashTable<T1,T2,Hash>& copy)
+{
+	this->size = copy.size;
+	this->deleted = copy.deleted;
+	this->capacity = copy.capacity;
+	this->control = copy.control;
+	this->table = copy.table;
+}
+
+// Destructor
+template <typename T1, typename T2, typename Hash>
+SwissHashTable<T1,T2,Hash>::~SwissHashTable() {
+	table.clear();
+}
+
+// Function to get the position of the lowest set bit of a non-zero group mask
+template <typename T1, typename T2, typename Hash>
+int SwissHashTable<T1,T2,Hash>::lowestSlot(unsigned mask) {
+#ifdef _MSC_VER
+	unsigned long position;
+	_BitScanForward(&position, mask);
+	return static_cast<int>(position);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// Function to get a bit mask of the slots in a group whose control byte equals tag
+template <typename T1, typename T2, typename Hash>
+unsigned SwissHashTable<T1,T2,Hash>::match(int group, int8_t tag) {
+	const int8_t* bytes = &control[group * GROUP_SIZE];
+#ifdef SWISS_TABLE_SSE2
+	__m128i controlBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+	return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(controlBytes, _mm_set1_epi8(tag))));
+#else
+	unsigned mask = 0;
+	for (int i = 0; i < GROUP_SIZE; i++) {
+		if (bytes[i] == tag) {
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+// Function to get a bit mask of the slots in a group that are empty or deleted (negative control bytes)
+template <typename T1, typename T2, typename Hash>
+unsigned SwissHashTable<T1,T2,Hash>::matchFree(int group) {
+	const int8_t* bytes = &control[group * GROUP_SIZE];
+#ifdef SWISS_TABLE_SSE2
+	__m128i controlBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+	return static_cast<unsigned>(_mm_movemask_epi8(controlBytes));
+#else
+	unsigned mask = 0;
+	for (int i = 0; i < GROUP_SIZE; i++) {
+		if (bytes[i] < 0) {
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#endif
+}
+
+// Function to find the slot holding a key, returns -1 if the key is not there.
+// Groups are probed quadratically, and the search stops at the first group with an empty slot
+template <typename T1, typename T2, typename Hash>
+template <typename K>
+int SwissHashTable<T1,T2,Hash>::findIndex(const K& key, size_t hashValue) {
+	int8_t tag = static_cast<int8_t>(hashValue & 0x7F);
+	int groupMask = capacity / GROUP_SIZE - 1;
+	int group = static_cast<int>((hashValue >> 7) & groupMask);
+
+	for (int step = 1; step <= groupMask + 1; step++) {
+		// Compare keys only in slots whose tag matches
+		for (unsigned candidates = match(group, tag); candidates != 0; candidates &= candidates - 1) {
+			int index = group * GROUP_SIZE + lowestSlot(candidates);
+			if (table[index].key == key) {
+				return index;
+			}
+		}
+		if (match(group, EMPTY) != 0) {
+			break;
+		}
+		group = (group + step) & groupMask;		// Move to the next group
+	}
+
+	return -1;
+}
+
+// Function to put a key known to be absent into the first empty or deleted slot on its probe sequence
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::place(T1&& key, T2&& value, size_t hashValue) {
+	int groupMask = capacity / GROUP_SIZE - 1;
+	int group = static_cast<int>((hashValue >> 7) & groupMask);
+
+	for (int step = 1; ; step++) {
+		unsigned freeSlots = matchFree(group);
+		if (freeSlots != 0) {
+			int index = group * GROUP_SIZE + lowestSlot(freeSlots);
+			if (control[index] == DELETED) {
+				deleted--;
+			}
+			control[index] = static_cast<int8_t>(hashValue & 0x7F);
+			table[index].key = std::move(key);
+			table[index].value = std::move(value);
+			return;
+		}
+		group = (group + step) & groupMask;
+	}
+}
+
+// Function to move every entry into a table of a new capacity, deleted slots are dropped
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::rehash(int newCapacity) {
+	std::vector<int8_t> oldControl(newCapacity, EMPTY);
+	std::vector<HashEntry> oldTable(newCapacity);
+	oldControl.swap(control);
+	oldTable.swap(table);
+	capacity = newCapacity;
+	deleted = 0;
+
+	for (int i = 0; i < static_cast<int>(oldControl.size()); i++) {
+		if (oldControl[i] >= 0) {
+			size_t hashValue = hash(oldTable[i].key);
+			place(std::move(oldTable[i].key), std::move(oldTable[i].value), hashValue);
+		}
+	}
+}
+
+// Function to start loading the control bytes of the first group probed for a hash
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::prefetchGroup(size_t hashValue) {
+	int group = static_cast<int>((hashValue >> 7) & (capacity / GROUP_SIZE - 1));
+	prefetchLine(&control[group * GROUP_SIZE]);
+}
+
+// Function to start loading the entry a lookup of the hash compares first, once its control bytes are
+// in the cache. A group of entries spans several cache lines, only the tag tells which one is needed
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::prefetchEntry(size_t hashValue) {
+	int group = static_cast<int>((hashValue >> 7) & (capacity / GROUP_SIZE - 1));
+	unsigned candidates = match(group, static_cast<int8_t>(hashValue & 0x7F));
+	if (candidates != 0) {
+		prefetchLine(&table[group * GROUP_SIZE + lowestSlot(candidates)]);
+	}
+}
+
+// Function to insert a key-value pair into the hash table
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::insert(T1 key, T2 value) {
+	size_t hashValue = hash(key);
+	insertHashed(std::move(key), std::move(value), hashValue);
+}
+
+// Function to insert a key-value pair, hashValue is the hash of the key
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::insertHashed(T1&& key, T2&& value, size_t hashValue) {
+	// Check if the key already exists
+	if (findIndex(key, hashValue) != -1) {
+		throw std::invalid_argument("Key already exists");
+	}
+
+	// Keep at least 1/8 of the slots empty so that unsuccessful searches stop early
+	if ((size + deleted + 1) > capacity / 8 * 7) {
+		// Grow if live entries fill the table, otherwise only clear deleted slots
+		rehash(size * 2 >= capacity / 8 * 7 ? capacity * 2 : capacity);
+	}
+
+	place(std::move(key), std::move(value), hashValue);
+	// Increment the size of the table
+	size++;
+}
+
+// Function to remove a key-value pair from the hash table
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::remove(T1 key) {
+	if (!tryRemove(key)) {
+		// Key not found
+		throw std::out_of_range("Key not found");
+	}
+}
+
+// Function to remove a key-value pair with a compatible key, throws if it is not there
+template <typename T1, typename T2, typename Hash>
+template <typename K, typename H, typename>
+void SwissHashTable<T1,T2,Hash>::remove(const K& key) {
+	if (!erase(key, hash(key))) {
+		throw std::out_of_range("Key not found");
+	}
+}
+
+// Function to remove a key-value pair if it is in the hash table
+template <typename T1, typename T2, typename Hash>
+bool SwissHashTable<T1,T2,Hash>::tryRemove(const T1& key) {
+	return erase(key, hash(key));
+}
+
+// Function to remove a key, returns false if it is not there
+template <typename T1, typename T2, typename Hash>
+template <typename K>
+bool SwissHashTable<T1,T2,Hash>::erase(const K& key, size_t hashValue) {
+	int index = findIndex(key, hashValue);
+	if (index == -1) {
+		return false;
+	}
+
+	// A group that still has an empty slot ends every probe sequence passing through it,
+	// so the slot can become empty again. Otherwise it has to stay a tombstone
+	if (match(index / GROUP_SIZE, EMPTY) != 0) {
+		control[index] = EMPTY;
+	}
+	else {
+		control[index] = DELETED;
+		deleted++;
+	}
+
+	table[index].key = T1();
+	table[index].value = T2();
+	// Decrement the size of the table
+	size--;
+	return true;
+}
+
+// Function to find the value associated with a key in the hash table
+template <typename T1, typename T2, typename Hash>
+T2* SwissHashTable<T1,T2,Hash>::find(const T1& key) {
+	int index = findIndex(key, hash(key));
+	if (index == -1) {
+		// Key not found
+		return nullptr;
+	}
+
+	// Return the value associated with the key
+	return &table[index].value;
+}
+
+// Function to find the value associated with a key of a compatible type
+template <typename T1, typename T2, typename Hash>
+template <typename K, typename H, typename>
+T2* SwissHashTable<T1,T2,Hash>::find(const K& key) {
+	int index = findIndex(key, hash(key));
+	return index != -1 ? &table[index].value : nullptr;
+}
+
+// Function to call operation(i, hashValue) for every key, a batch of keys at a time. Every key of a batch
+// is hashed and the control bytes of its first group prefetched, then the entries their tags point to,
+// and only then is the first key resolved. The hashes do not depend on the capacity, so they stay valid
+// when an insert of the batch grows the table
+template <typename T1, typename T2, typename Hash>
+template <typename Operation>
+void SwissHashTable<T1,T2,Hash>::forEachBatch(const T1* keys, size_t count, Operation operation) {
+	size_t hashes[PREFETCH_BATCH];
+
+	for (size_t start = 0; start < count; start += PREFETCH_BATCH) {
+		size_t batch = count - start < PREFETCH_BATCH ? count - start : PREFETCH_BATCH;
+		for (size_t i = 0; i < batch; i++) {
+			hashes[i] = hash(keys[start + i]);
+			prefetchGroup(hashes[i]);
+		}
+		for (size_t i = 0; i < batch; i++) {
+			prefetchEntry(hashes[i]);
+		}
+		for (size_t i = 0; i < batch; i++) {
+			operation(start + i, hashes[i]);
+		}
+	}
+}
+
+// Function to find the values of an array of keys
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::findBatch(const T1* keys, size_t count, T2** values) {
+	forEachBatch(keys, count, [this, keys, values](size_t i, size_t hashValue) {
+		int index = findIndex(keys[i], hashValue);
+		values[i] = index != -1 ? &table[index].value : nullptr;
+	});
+}
+
+// Function to insert an array of key-value pairs
+template <typename T1, typename T2, typename Hash>
+void SwissHashTable<T1,T2,Hash>::insertBatch(const T1* keys, const T2* values, size_t count) {
+	forEachBatch(keys, count, [this, keys, values](size_t i, size_t hashValue) { insertHashed(T1(keys[i]), T2(values[i]), hashValue); });
+}
+
+// Function to remove an array of keys, returns the number of keys that were there
+template <typename T1, typename T2, typename Hash>
+size_t SwissHashTable<T1,T2,Hash>::removeBatch(const T1* keys, size_t count) {
+	size_t removed = 0;
+	forEachBatch(keys, count, [this, keys, &removed](size_t i, size_t hashValue) {
+		if (erase(keys[i], hashValue)) {
+			removed++;
+		}
+	});
+	return removed;
+}
+
+#endif //SWISS_HASH_TABLE_HPP
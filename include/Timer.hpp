@@ -15,7 +15,7 @@ public:
 
 private:
 	high_resolution_clock::time_point start_time, end_time;
-	duration<double> duration;
+	std::chrono::duration<double> duration;
 };
 
 void Timer::start()
@@ -0,0 +1,324 @@
+#ifndef UNROLLED_BUCKET_HPP
+#define UNROLLED_BUCKET_HPP
+
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+#include "NodePool.hpp"
+#include "Hasher.hpp"
+#include "Prefetch.hpp"
+
+#define CACHE_LINE_SIZE 64
+
+// Unrolled bucket for separate chaining. Entries are kept in blocks sized to a cache line, the first
+// block lives inside the bucket itself and only overflow blocks are linked. Entries are packed at the
+// front: an erase fills its hole with the last entry of the bucket, so lookups never skip gaps
+template <typename T1, typename T2>
+class alignas(CACHE_LINE_SIZE) UnrolledBucket
+{
+private:
+	// The hash of the key is stored with it for keys that are not scalars, see StoredHash
+	struct Entry : StoredHash<T1>
+	{
+		T1 key;
+		T2 value;
+	};
+
+	// Number of entries that fit in a cache line next to the link, the count and the pool pointer of the bucket
+	static constexpr int BLOCK_ENTRIES = (CACHE_LINE_SIZE - 2 * sizeof(void*) - sizeof(int)) / sizeof(Entry) > 0 ?
+		(CACHE_LINE_SIZE - 2 * sizeof(void*) - sizeof(int)) / sizeof(Entry) : 1;
+
+public:
+	struct Block
+	{
+		Entry entries[BLOCK_ENTRIES];
+		Block* next = nullptr;
+		int count = 0;
+	};
+
+	typedef NodePool<Block> Pool;
+
+private:
+	Block head_;		// First block, stored inline
+	Pool* pool_;		// Overflow blocks come from this pool if set, from new otherwise
+
+	Block* createBlock();
+	void destroyBlock(Block* block);
+
+public:
+	UnrolledBucket(Pool* pool = nullptr);
+	UnrolledBucket(UnrolledBucket<T1, T2>&& other);
+	UnrolledBucket(const UnrolledBucket<T1, T2>&) = delete;
+	UnrolledBucket<T1, T2>& operator=(const UnrolledBucket<T1, T2>&) = delete;
+	~UnrolledBucket();
+
+	template <typename K, typename V>
+	void pushBack(K&& key, V&& value, uint64_t hashValue);
+	template <typename K>
+	T2* findValue(const K& key, uint64_t hashValue);
+	template <typename K>
+	bool erase(const K& key, uint64_t hashValue);
+	void prefetch() const;
+	void release();
+	void clear();
+
+	template <typename Function>
+	void forEach(Function function) const;
+	template <typename Function>
+	void drain(Function function);
+
+	int getSize() const;
+	bool isEmpty() const;
+	void show() const;
+};
+
+template <typename T1, typename T2>
+UnrolledBucket<T1, T2>::UnrolledBucket(Pool* pool) : pool_(pool) {}
+
+// Take over the entries and overflow blocks of another bucket
+template <typename T1, typename T2>
+UnrolledBucket<T1, T2>::UnrolledBucket(UnrolledBucket<T1, T2>&& other) : pool_(other.pool_)
+{
+	for (int i = 0; i < other.head_.count; i++)
+		head_.entries[i] = std::move(other.head_.entries[i]);
+
+	head_.count = other.head_.count;
+	head_.next = other.head_.next;
+
+	other.head_.count = 0;
+	other.head_.next = nullptr;
+}
+
+template <typename T1, typename T2>
+UnrolledBucket<T1, T2>::~UnrolledBucket()
+{
+	clear();
+}
+
+// Remove every entry and give the overflow blocks back
+template <typename T1, typename T2>
+void UnrolledBucket<T1, T2>::clear()
+{
+	Block* block = head_.next;
+
+	while (block != nullptr)
+	{
+		Block* next = block->next;
+		destroyBlock(block);
+		block = next;
+	}
+
+	for (int i = 0; i < head_.count; i++)
+		head_.entries[i] = Entry();
+
+	head_.next = nullptr;
+	head_.count = 0;
+}
+
+// Get an overflow block from the pool or the heap
+template <typename T1, typename T2>
+typename UnrolledBucket<T1, T2>::Block* UnrolledBucket<T1, T2>::createBlock()
+{
+	if (pool_ != nullptr)
+		return pool_->allocate();
+
+	return new Block;
+}
+
+// Give an overflow block back to where it came from
+template <typename T1, typename T2>
+void UnrolledBucket<T1, T2>::destroyBlock(Block* block)
+{
+	if (pool_ != nullptr)
+		pool_->deallocate(block);
+	else
+		delete block;
+}
+
+// Append an entry to the last block, linking a new block if it is full. Rvalues are moved into the entry
+template <typename T1, typename T2>
+template <typename K, typename V>
+void UnrolledBucket<T1, T2>::pushBack(K&& key, V&& value, uint64_t hashValue)
+{
+	Block* block = &head_;
+
+	while (block->next != nullptr)
+		block = block->next;
+
+	if (block->count == BLOCK_ENTRIES)
+	{
+		block->next = createBlock();
+		block = block->next;
+	}
+
+	block->entries[block->count].key = std::forward<K>(key);
+	block->entries[block->count].value = std::forward<V>(value);
+	block->entries[block->count].setHash(hashValue);
+	block->count++;
+}
+
+// Start loading the first overflow block, the first block comes with the bucket itself
+template <typename T1, typename T2>
+void UnrolledBucket<T1, T2>::prefetch() const
+{
+	if (head_.next != nullptr)
+		prefetchLine(head_.next);
+}
+
+// Return a pointer to the value stored with the key, or nullptr. The key may be of any type comparable to T1 with ==,
+// it is compared only in entries that store its hash
+template <typename T1, typename T2>
+template <typename K>
+T2* UnrolledBucket<T1, T2>::findValue(const K& key, uint64_t hashValue)
+{
+	for (Block* block = &head_; block != nullptr; block = block->next)
+	{
+		for (int i = 0; i < block->count; i++)
+		{
+			if (block->entries[i].hashMatches(hashValue) && block->entries[i].key == key)
+				return &block->entries[i].value;
+		}
+	}
+
+	return nullptr;
+}
+
+// Remove the first entry with the key in one pass: the walk goes on from the match to the last block,
+// whose last entry fills the hole. Returns false if the key is not there
+template <typename T1, typename T2>
+template <typename K>
+bool UnrolledBucket<T1, T2>::erase(const K& key, uint64_t hashValue)
+{
+	Entry* hole = nullptr;
+	Block* previous = nullptr;
+	Block* block = &head_;
+
+	while (true)
+	{
+		if (hole == nullptr)
+		{
+			for (int i = 0; i < block->count; i++)
+			{
+				if (block->entries[i].hashMatches(hashValue) && block->entries[i].key == key)
+				{
+					hole = &block->entries[i];
+					break;
+				}
+			}
+		}
+
+		if (block->next == nullptr)
+			break;
+
+		previous = block;
+		block = block->next;
+	}
+
+	if (hole == nullptr)
+		return false;
+
+	// Move the last entry into the hole
+	Entry& last = block->entries[block->count - 1];
+
+	if (hole != &last)
+		*hole = std::move(last);
+
+	last = Entry();
+	block->count--;
+
+	// Unlink an overflow block that became empty
+	if (block->count == 0 && previous != nullptr)
+	{
+		previous->next = nullptr;
+		destroyBlock(block);
+	}
+
+	return true;
+}
+
+// Forget overflow blocks without returning them, for pooled buckets whose pool is about to free its slabs.
+// Destructors still run for keys and values that need them
+template <typename T1, typename T2>
+void UnrolledBucket<T1, T2>::release()
+{
+	if (pool_ == nullptr)
+		return;
+
+	if (!std::is_trivially_destructible<Block>::value)
+	{
+		Block* block = head_.next;
+
+		while (block != nullptr)
+		{
+			Block* next = block->next;
+			block->~Block();
+			block = next;
+		}
+	}
+
+	head_.next = nullptr;
+}
+
+// Call function(key, value) for every entry
+template <typename T1, typename T2>
+template <typename Function>
+void UnrolledBucket<T1, T2>::forEach(Function function) const
+{
+	for (const Block* block = &head_; block != nullptr; block = block->next)
+	{
+		for (int i = 0; i < block->count; i++)
+			function(block->entries[i].key, block->entries[i].value);
+	}
+}
+
+// Call function(key, value, storedHash) for every entry, handing over the key and the value as rvalues,
+// and give the overflow blocks back. The bucket is empty afterwards
+template <typename T1, typename T2>
+template <typename Function>
+void UnrolledBucket<T1, T2>::drain(Function function)
+{
+	for (Block* block = &head_; block != nullptr; block = block->next)
+	{
+		for (int i = 0; i < block->count; i++)
+			function(std::move(block->entries[i].key), std::move(block->entries[i].value), static_cast<const StoredHash<T1>&>(block->entries[i]));
+	}
+
+	clear();
+}
+
+template <typename T1, typename T2>
+int UnrolledBucket<T1, T2>::getSize() const
+{
+	int size = 0;
+
+	for (const Block* block = &head_; block != nullptr; block = block->next)
+		size += block->count;
+
+	return size;
+}
+
+template <typename T1, typename T2>
+bool UnrolledBucket<T1, T2>::isEmpty() const
+{
+	return head_.count == 0;
+}
+
+// Display every entry, one block per group of braces
+template <typename T1, typename T2>
+void UnrolledBucket<T1, T2>::show() const
+{
+	for (const Block* block = &head_; block != nullptr; block = block->next)
+	{
+		std::cout << "[ ";
+
+		for (int i = 0; i < block->count; i++)
+			std::cout << "{ " << block->entries[i].key << ", " << block->entries[i].value << " } ";
+
+		std::cout << "] -> ";
+	}
+
+	std::cout << '\n';
+}
+
+#endif
@@ -4,9 +4,31 @@
 #include <cstdlib>
 #include <ctime>
 #include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <atomic>
 #include "Timer.hpp"
 #include "ClosedAddressingTable.hpp"
 #include "CuckooHashingTable.hpp"
+#include "BucketizedCuckooTable.hpp"
+#include "OpenAddressingHashTable.hpp"
+#include "RobinHoodHashTable.hpp"
+#include "SwissHashTable.hpp"
+#include "Hasher.hpp"
+#include "RangePolicy.hpp"
+#include "UnrolledBucket.hpp"
+#include "HybridBucket.hpp"
+#include "AVL.hpp"
+#include "IndexedAVL.hpp"
+#include "BPlusTree.hpp"
+#include "ShardedTable.hpp"
+#include "LockFreeOpenAddressingTable.hpp"
+#include "ConcurrentCuckooTable.hpp"
+#include "LockFreeChainingTable.hpp"
 
 std::vector<int> generateIntDataSet(int size, int seed = time(NULL), int start = 0, int end = 100000)
 {
@@ -63,4 +85,1093 @@ void measurePerformance(int repetitions, int dataSetSize)
 	std::cout << "Average time: " << averageTime << "ns\n";
 }
 
+// Fill a table with unique random keys up to the given load factor and measure average time of successful and unsuccessful searches
+template <typename Table>
+void measureSearchPerformance(int repetitions, int tableSize, float loadFactor)
+{
+	Table ht(tableSize);
+
+	std::vector<int> keys = generateIntDataSet(tableSize * loadFactor, 1, 0, tableSize * 10);
+	std::vector<int> inserted;
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		try
+		{
+			ht.insert(keys[i], i);
+			inserted.push_back(keys[i]);
+		}
+		catch (const std::invalid_argument&)
+		{
+			// Duplicate key, skip it
+		}
+	}
+
+	srand(time(NULL));
+
+	volatile int found = 0;		// Keeps the searches from being optimized away
+	Timer timer;
+
+	// Every searched key is present
+	timer.start();
+	for (int i = 0; i < repetitions; i++)
+		found = *ht.find(inserted[rand() % inserted.size()]);
+	timer.stop();
+
+	double hitTime = timer.getDuration() / repetitions;
+
+	// No searched key is present, keys in the table are never negative
+	timer.start();
+	for (int i = 0; i < repetitions; i++)
+		found = ht.find(-1 - rand() % (tableSize * 10)) != nullptr;
+	timer.stop();
+
+	double missTime = timer.getDuration() / repetitions;
+
+	// The same misses reported by the exception of search
+	timer.start();
+	for (int i = 0; i < repetitions; i++)
+	{
+		try
+		{
+			found = ht.search(-1 - rand() % (tableSize * 10));
+		}
+		catch (const std::out_of_range&)
+		{
+			// Expected
+		}
+	}
+	timer.stop();
+
+	double throwTime = timer.getDuration() / repetitions;
+	(void)found;
+
+	std::cout << "Average search time: " << hitTime << "ns (hit), " << missTime << "ns (miss), " << throwTime << "ns (miss with exception)\n";
+}
+
+// Compare linear probing, Robin Hood probing and Swiss table group probing on tables filled to the same load factor.
+// The Swiss table rounds its capacity up, so its actual load factor is lower or equal
+void compareProbing(int repetitions, int tableSize, float loadFactor)
+{
+	std::cout << "Load factor " << loadFactor << "\n";
+
+	std::cout << "Linear probing: ";
+	measureSearchPerformance<OpenAddressingTable<int, int>>(repetitions, tableSize, loadFactor);
+
+	std::cout << "Robin Hood probing: ";
+	measureSearchPerformance<RobinHoodHashTable<int, int>>(repetitions, tableSize, loadFactor);
+
+	std::cout << "Swiss table probing: ";
+	measureSearchPerformance<SwissHashTable<int, int>>(repetitions, tableSize, loadFactor);
+}
+
+// Measure average cost of one probe step under a range policy: every lookup reduces a hash to an index and takes a few linear probe steps
+template <typename Range>
+double measureProbeCost(int repetitions, size_t tableSize)
+{
+	const int steps = 4;
+	size_t capacity = Range::capacity(tableSize);
+
+	std::vector<int> keys = generateIntDataSet(repetitions);
+	std::vector<uint64_t> hashes;
+	Hasher<int> hashFunction;
+
+	for (int i = 0; i < repetitions; i++)
+		hashes.push_back(hashFunction(keys[i]));
+
+	size_t sum = 0;
+	Timer timer;
+
+	timer.start();
+	for (int i = 0; i < repetitions; i++)
+	{
+		size_t index = Range::reduce(hashes[i], capacity);
+
+		for (int j = 0; j < steps; j++)
+			index = Range::next(index, capacity);
+
+		sum += index;
+	}
+	timer.stop();
+
+	volatile size_t result = sum;		// Keeps the loop from being optimized away
+	(void)result;
+
+	return timer.getDuration() / (repetitions * (steps + 1.0));
+}
+
+// Compare range policies, first per probe step and then on linear probing searches
+void compareRangePolicies(int repetitions, int tableSize, float loadFactor)
+{
+	std::cout << "Modulo: " << measureProbeCost<ModuloRange>(repetitions, tableSize) << "ns per probe\n";
+	std::cout << "Power of two mask: " << measureProbeCost<PowerOfTwoRange>(repetitions, tableSize) << "ns per probe\n";
+	std::cout << "Multiply-shift: " << measureProbeCost<FastRange>(repetitions, tableSize) << "ns per probe\n";
+
+	std::cout << "Linear probing with modulo: ";
+	measureSearchPerformance<OpenAddressingTable<int, int, Hasher<int>, ModuloRange>>(repetitions, tableSize, loadFactor);
+
+	std::cout << "Linear probing with power of two mask: ";
+	measureSearchPerformance<OpenAddressingTable<int, int, Hasher<int>, PowerOfTwoRange>>(repetitions, tableSize, loadFactor);
+
+	std::cout << "Linear probing with multiply-shift: ";
+	measureSearchPerformance<OpenAddressingTable<int, int, Hasher<int>, FastRange>>(repetitions, tableSize, loadFactor);
+}
+
+// Measure average time of inserting and then removing every key of a data set in a chained table with a given number of buckets
+template <typename Table>
+void measureChainingPerformance(Table& ht, const std::vector<int>& keys)
+{
+	Timer timer;
+
+	timer.start();
+	for (size_t i = 0; i < keys.size(); i++)
+		ht.insert(keys[i], i);
+	timer.stop();
+
+	double insertTime = timer.getDuration() / keys.size();
+
+	// Every removal walks a chain to find its key
+	timer.start();
+	for (size_t i = 0; i < keys.size(); i++)
+		ht.remove(keys[i]);
+	timer.stop();
+
+	double removeTime = timer.getDuration() / keys.size();
+
+	std::cout << "Average time: " << insertTime << "ns (insert), " << removeTime << "ns (remove)\n";
+}
+
+// Compare separate chaining with nodes from the heap and from the table's node pool, at the given average chain length
+void compareChainAllocation(int dataSetSize, int chainLength)
+{
+	std::vector<int> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = i;
+
+	// Unique keys, so every insert adds a node and every remove frees one
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "Heap allocated nodes: ";
+	ClosedAddressingTable<int, int> heapTable(dataSetSize / chainLength, false, false);
+	measureChainingPerformance(heapTable, keys);
+
+	std::cout << "Pooled nodes: ";
+	ClosedAddressingTable<int, int> pooledTable(dataSetSize / chainLength, true, false);
+	measureChainingPerformance(pooledTable, keys);
+}
+
+// Compare chaining with one entry per node, chaining with cache line sized blocks, both at load factor 1.0, and linear probing
+void compareChainingModes(int dataSetSize)
+{
+	std::vector<int> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = i;
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "Chaining with linked nodes: ";
+	ClosedAddressingTable<int, int> listTable(dataSetSize);
+	measureChainingPerformance(listTable, keys);
+
+	std::cout << "Chaining with unrolled blocks: ";
+	ClosedAddressingTable<int, int, Hasher<int>, ModuloRange, UnrolledBucket<int, int>> unrolledTable(dataSetSize);
+	measureChainingPerformance(unrolledTable, keys);
+
+	std::cout << "Linear probing: ";
+	OpenAddressingTable<int, int> openTable(dataSetSize, true);
+	measureChainingPerformance(openTable, keys);
+}
+
+// Check that lookups on a growing open addressing table keep earlier pointers valid, throws std::logic_error
+// if they do not. Every insert that grows the table leaves the first keys in the old table. Pointers to
+// them, taken one lookup after another, have to stay the ones find and findBatch return and still read their values
+void checkMigrationLookups(int dataSetSize)
+{
+	const int tracked = 32;
+	OpenAddressingTable<int, int> table(16, true);
+	int keys[tracked];
+	int* values[tracked];
+	int* batchValues[tracked];
+
+	for (int j = 0; j < tracked; j++)
+		keys[j] = j;
+
+	for (int i = 0; i < dataSetSize; i++)
+	{
+		table.insert(i, i * 2);
+
+		int count = i + 1 < tracked ? i + 1 : tracked;
+
+		for (int j = 0; j < count; j++)
+		{
+			values[j] = table.find(j);
+
+			if (values[j] == nullptr || *values[j] != j * 2)
+				throw std::logic_error("A lookup missed an inserted key or read a wrong value");
+		}
+
+		table.findBatch(keys, count, batchValues);
+
+		for (int j = 0; j < count; j++)
+		{
+			if (table.find(j) != values[j] || batchValues[j] != values[j] || *values[j] != j * 2)
+				throw std::logic_error("A lookup moved an entry an earlier pointer refers to");
+		}
+	}
+}
+
+// Hasher sending every key to one of eight buckets, the worst case for separate chaining
+struct CollidingHasher
+{
+	uint64_t operator()(int key, uint64_t = 0) const
+	{
+		return static_cast<uint64_t>(key) % 8;
+	}
+};
+
+// Compare chains that stay linked lists with chains that turn into AVL trees, when every key collides with many others
+void compareTreeifiedChains(int dataSetSize)
+{
+	std::vector<int> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = i;
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "Linked chains: ";
+	ClosedAddressingTable<int, int, CollidingHasher, ModuloRange, SinglyLinkedList<int, int>> listTable(64);
+	measureChainingPerformance(listTable, keys);
+
+	std::cout << "Treeified chains: ";
+	ClosedAddressingTable<int, int, CollidingHasher, ModuloRange, HybridBucket<int, int>> hybridTable(64);
+	measureChainingPerformance(hybridTable, keys);
+}
+
+// Measure average insert and search time of a tree, and the time it takes to destroy it
+template <typename Tree>
+void measureTreePerformance(const std::vector<int>& keys)
+{
+	Timer timer;
+	Tree* tree = new Tree();
+
+	timer.start();
+	for (size_t i = 0; i < keys.size(); i++)
+		tree->insert(keys[i], i);
+	timer.stop();
+
+	double insertTime = timer.getDuration() / keys.size();
+
+	volatile int found = 0;
+
+	timer.start();
+	for (size_t i = 0; i < keys.size(); i++)
+		found = *tree->find(keys[i]);
+	timer.stop();
+
+	double searchTime = timer.getDuration() / keys.size();
+	(void)found;
+
+	timer.start();
+	delete tree;
+	timer.stop();
+
+	std::cout << "Average time: " << insertTime << "ns (insert), " << searchTime << "ns (search), destruction: " << timer.getDuration() / 1e6 << "ms\n";
+}
+
+// Compare the AVL tree with pointer linked nodes and the one with nodes in an arena linked by 32 bit indices
+void compareTreeLayouts(int dataSetSize)
+{
+	std::vector<int> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = i;
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "Pointer nodes (" << sizeof(AVLNode<int, int>) << " bytes): ";
+	measureTreePerformance<AVL<int, int>>(keys);
+
+	std::cout << "Indexed nodes (" << sizeof(IndexedAVLNode<int, int>) << " bytes): ";
+	measureTreePerformance<IndexedAVL<int, int>>(keys);
+}
+
+// Compare the ordered structures: AVL with pointer nodes, AVL with indexed nodes and the B+ tree,
+// then time a scan over every key in order with the AVL and with the linked leaves of the B+ tree
+void compareOrderedTrees(int dataSetSize)
+{
+	std::vector<int> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = i;
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "AVL tree: ";
+	measureTreePerformance<AVL<int, int>>(keys);
+
+	std::cout << "Indexed AVL tree: ";
+	measureTreePerformance<IndexedAVL<int, int>>(keys);
+
+	std::cout << "B+ tree: ";
+	measureTreePerformance<BPlusTree<int, int>>(keys);
+
+	AVL<int, int> avl;
+	BPlusTree<int, int> bPlusTree;
+
+	for (int i = 0; i < dataSetSize; i++)
+	{
+		avl.insert(keys[i], i);
+		bPlusTree.insert(keys[i], i);
+	}
+
+	Timer timer;
+	volatile long long sum = 0;
+
+	timer.start();
+	avl.forEach([&sum](const int&, const int& value) { sum = sum + value; });
+	timer.stop();
+	std::cout << "In order scan, AVL tree: " << timer.getDuration() / 1e6 << "ms\n";
+
+	timer.start();
+	bPlusTree.forEach([&sum](const int&, const int& value) { sum = sum + value; });
+	timer.stop();
+	std::cout << "In order scan, B+ tree: " << timer.getDuration() / 1e6 << "ms\n";
+}
+
+// Compare filling an AVL tree key by key with building it in bulk from sorted and from unsorted pairs, and time a copy
+void compareTreeBuilds(int dataSetSize)
+{
+	std::vector<std::pair<int, int>> items(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		items[i] = std::make_pair(i, i);
+
+	std::vector<std::pair<int, int>> shuffled(items);
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+
+	Timer timer;
+
+	timer.start();
+	AVL<int, int> inserted;
+	for (int i = 0; i < dataSetSize; i++)
+		inserted.insert(shuffled[i].first, shuffled[i].second);
+	timer.stop();
+	std::cout << "Insert one by one: " << timer.getDuration() / 1e6 << "ms\n";
+
+	timer.start();
+	AVL<int, int> sorted(items.begin(), items.end());
+	timer.stop();
+	std::cout << "Bulk build, sorted input: " << timer.getDuration() / 1e6 << "ms\n";
+
+	timer.start();
+	AVL<int, int> unsorted(shuffled.begin(), shuffled.end());
+	timer.stop();
+	std::cout << "Bulk build, unsorted input: " << timer.getDuration() / 1e6 << "ms\n";
+
+	timer.start();
+	AVL<int, int> copy(inserted);
+	timer.stop();
+	std::cout << "Copy: " << timer.getDuration() / 1e6 << "ms\n";
+}
+
+// Measure average insert, search and remove time of an AVL tree with string keys, which are expensive to copy
+void measureStringTreePerformance(int dataSetSize)
+{
+	std::vector<std::string> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = "key-with-a-heap-allocated-name-" + std::to_string(i);
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	AVL<std::string, int> tree;
+	Timer timer;
+
+	timer.start();
+	for (int i = 0; i < dataSetSize; i++)
+		tree.insert(keys[i], i);
+	timer.stop();
+	double insertTime = timer.getDuration() / dataSetSize;
+
+	volatile int found = 0;
+
+	timer.start();
+	for (int i = 0; i < dataSetSize; i++)
+		found = *tree.find(keys[i]);
+	timer.stop();
+	double searchTime = timer.getDuration() / dataSetSize;
+	(void)found;
+
+	timer.start();
+	for (int i = 0; i < dataSetSize; i++)
+		tree.remove(keys[i]);
+	timer.stop();
+	double removeTime = timer.getDuration() / dataSetSize;
+
+	std::cout << "Average time: " << insertTime << "ns (insert), " << searchTime << "ns (search), " << removeTime << "ns (remove)\n";
+}
+
+// Measure the average and the slowest single insert into a table that starts small and has to resize many times
+template <typename Table>
+void measureInsertLatency(Table& ht, const std::vector<int>& keys)
+{
+	Timer timer;
+	double totalTime = 0, worstTime = 0;
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		timer.start();
+		ht.insert(keys[i], i);
+		timer.stop();
+
+		double time = timer.getDuration();
+		totalTime += time;
+
+		if (time > worstTime)
+			worstTime = time;
+	}
+
+	std::cout << "Average insert: " << totalTime / keys.size() << "ns, slowest insert: " << worstTime << "ns\n";
+}
+
+// Compare insert latency of chaining tables growing from 16 buckets by incremental resizing, with linked and unrolled chains
+void compareResizeLatency(int dataSetSize)
+{
+	std::vector<int> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = i;
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "Chaining with linked nodes: ";
+	ClosedAddressingTable<int, int> listTable(16);
+	measureInsertLatency(listTable, keys);
+
+	std::cout << "Chaining with unrolled blocks: ";
+	ClosedAddressingTable<int, int, Hasher<int>, ModuloRange, UnrolledBucket<int, int>> unrolledTable(16);
+	measureInsertLatency(unrolledTable, keys);
+}
+
+// Compare lookups of keys held as slices of one buffer, the way a request parser holds them: building a
+// std::string from every slice first, against passing the std::string_view to the transparent hasher
+void compareStringViewLookup(int dataSetSize)
+{
+	const std::string prefix = "key-with-a-heap-allocated-name-";
+	std::string buffer;
+
+	for (int i = 0; i < dataSetSize; i++)
+		buffer += prefix + std::to_string(i) + ' ';
+
+	// Cut the buffer into slices at the separators
+	std::vector<std::string_view> slices;
+	size_t start = 0;
+
+	for (size_t end = buffer.find(' '); end != std::string::npos; end = buffer.find(' ', start))
+	{
+		slices.push_back(std::string_view(buffer.data() + start, end - start));
+		start = end + 1;
+	}
+
+	std::shuffle(slices.begin(), slices.end(), std::mt19937(1));
+
+	SwissHashTable<std::string, int> table(dataSetSize * 2);
+
+	for (int i = 0; i < dataSetSize; i++)
+		table.insert(std::string(slices[i]), i);
+
+	Timer timer;
+	volatile bool found = false;
+
+	timer.start();
+	for (int i = 0; i < dataSetSize; i++)
+		found = table.contains(std::string(slices[i]));
+	timer.stop();
+	double stringTime = timer.getDuration() / dataSetSize;
+
+	timer.start();
+	for (int i = 0; i < dataSetSize; i++)
+		found = table.contains(slices[i]);
+	timer.stop();
+	double viewTime = timer.getDuration() / dataSetSize;
+	(void)found;
+
+	std::cout << "Average lookup: " << stringTime << "ns (std::string built from the slice), " << viewTime << "ns (std::string_view)\n";
+}
+
+// Measure average insert and successful search times with string keys
+template <typename Table>
+void measureStringKeyPerformance(Table& ht, const std::vector<std::string>& keys)
+{
+	Timer timer;
+
+	timer.start();
+	for (size_t i = 0; i < keys.size(); i++)
+		ht.insert(keys[i], i);
+	timer.stop();
+	double insertTime = timer.getDuration() / keys.size();
+
+	volatile bool found = false;
+
+	timer.start();
+	for (size_t i = 0; i < keys.size(); i++)
+		found = ht.contains(keys[i]);
+	timer.stop();
+	double searchTime = timer.getDuration() / keys.size();
+	(void)found;
+
+	std::cout << "Average time: " << insertTime << "ns (insert), " << searchTime << "ns (search)\n";
+}
+
+// Compare tables on long string keys that differ only at the end, so every full key comparison
+// reads the whole shared prefix. Stored hashes let probes and chains skip most of those comparisons
+void compareStringKeyTables(int dataSetSize)
+{
+	std::vector<std::string> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = std::string(64, 'k') + std::to_string(i);
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "Linear probing: ";
+	OpenAddressingTable<std::string, int> openTable(dataSetSize / 0.9 + 1);
+	measureStringKeyPerformance(openTable, keys);
+
+	std::cout << "Chaining: ";
+	ClosedAddressingTable<std::string, int> closedTable(dataSetSize / 4, true, false);
+	measureStringKeyPerformance(closedTable, keys);
+
+	std::cout << "Cuckoo hashing: ";
+	CuckooHashingTable<std::string, int> cuckooTable(dataSetSize);
+	measureStringKeyPerformance(cuckooTable, keys);
+}
+
+// Run threadCount threads, each calling operation(generator, i) for i below operationsPerThread with a
+// generator seeded by its number. Returns millions of operations per second over all threads
+template <typename Operation>
+double measureThreads(int threadCount, int operationsPerThread, Operation operation)
+{
+	std::vector<std::thread> threads;
+	Timer timer;
+
+	timer.start();
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&operation, operationsPerThread, t]()
+		{
+			std::mt19937 generator(t + 1);
+
+			for (int i = 0; i < operationsPerThread; i++)
+				operation(generator, i);
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+	timer.stop();
+
+	return static_cast<double>(operationsPerThread) * threadCount / timer.getDuration() * 1000.0;
+}
+
+// Run threadCount threads over a shared table, each doing operations on random keys: 90% lookups,
+// 5% inserts and 5% removals. Returns millions of operations per second over all threads
+template <typename Table>
+double measureConcurrentThroughput(Table& ht, int keyRange, int operationsPerThread, int threadCount)
+{
+	return measureThreads(threadCount, operationsPerThread, [&ht, keyRange](std::mt19937& generator, int i)
+	{
+		int key = generator() % keyRange;
+		int operation = generator() % 20;
+
+		if (operation == 0)
+			ht.tryEmplace(key, i);
+		else if (operation == 1)
+			ht.tryRemove(key);
+		else
+			ht.contains(key);
+	});
+}
+
+// Compare one lock over the whole table against a table split into shards with a lock each, for a
+// growing number of threads on a mixed read/write workload
+void compareShardedTable(int dataSetSize, int maxThreads)
+{
+	const int shardCount = 64;
+	const int operationsPerThread = 1000000;
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		ShardedTable<int, int, ClosedAddressingTable<int, int>> globalTable(1, static_cast<size_t>(dataSetSize));
+		ShardedTable<int, int, ClosedAddressingTable<int, int>> shardedTable(shardCount, static_cast<size_t>(dataSetSize / shardCount + 1));
+
+		for (int i = 0; i < dataSetSize; i += 2)
+		{
+			globalTable.insert(i, i);
+			shardedTable.insert(i, i);
+		}
+
+		std::cout << threads << " threads: " << measureConcurrentThroughput(globalTable, dataSetSize, operationsPerThread, threads) << " Mops/s (one lock), "
+			<< measureConcurrentThroughput(shardedTable, dataSetSize, operationsPerThread, threads) << " Mops/s (" << shardCount << " shards)\n";
+	}
+}
+
+// Check the lock-free table under threadCount threads, throws std::logic_error if an invariant broke:
+// concurrent inserts of disjoint keys all land, concurrent adds to shared counters lose no increment,
+// and readers racing with inserts and removals only ever see the value that belongs to a key
+void stressLockFreeTable(int threadCount, int keysPerThread)
+{
+	LockFreeOpenAddressingTable<int, int> table(static_cast<size_t>(threadCount) * keysPerThread * 2 + 1024);
+	const int keyRange = threadCount * keysPerThread;
+	std::atomic<int> wrongValues(0);
+
+	// Every thread inserts its own keys and reads random keys of the others in between
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&table, &wrongValues, keysPerThread, keyRange, t]()
+		{
+			std::mt19937 generator(t + 1);
+			int value;
+
+			for (int i = 0; i < keysPerThread; i++)
+			{
+				table.insert(t * keysPerThread + i, (t * keysPerThread + i) * 2);
+
+				int key = static_cast<int>(generator() % keyRange);
+
+				if (table.find(key, value) && value != key * 2)
+					wrongValues++;
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (int key = 0; key < keyRange; key++)
+	{
+		int value;
+
+		if (!table.find(key, value) || value != key * 2)
+			throw std::logic_error("An inserted key is missing");
+	}
+
+	// Shared counters on negative keys, which the other phases do not use
+	const int counters = 64;
+
+	measureThreads(threadCount, keysPerThread, [&table](std::mt19937& generator, int)
+	{
+		table.add(-1 - static_cast<int>(generator() % counters), 1);
+	});
+
+	long long total = 0;
+
+	for (int key = -1; key >= -counters; key--)
+	{
+		int value;
+
+		if (table.find(key, value))
+			total += value;
+	}
+
+	if (total != static_cast<long long>(threadCount) * keysPerThread)
+		throw std::logic_error("Concurrent adds lost an increment");
+
+	// Removals and re-inserts racing with readers
+	measureThreads(threadCount, keysPerThread, [&table, &wrongValues, keyRange](std::mt19937& generator, int i)
+	{
+		int key = static_cast<int>(generator() % keyRange);
+		int value;
+
+		if (i % 4 == 0)
+			table.tryRemove(key);
+		else if (i % 4 == 1)
+			table.insert(key, key * 2);
+		else if (table.find(key, value) && value != key * 2)
+			wrongValues++;
+	});
+
+	if (wrongValues != 0)
+		throw std::logic_error("Read a value that belongs to another key");
+
+	std::cout << "Lock-free table: " << threadCount << " threads passed\n";
+}
+
+// Compare the lock-free table against a sharded table on read-heavy counters: 90% lookups and 10%
+// increments of random keys, from 1 to maxThreads threads
+void compareLockFreeTable(int dataSetSize, int maxThreads)
+{
+	const int operationsPerThread = 1000000;
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		LockFreeOpenAddressingTable<int, int> lockFreeTable(dataSetSize * 2);
+		ShardedTable<int, int, ClosedAddressingTable<int, int>> shardedTable(64, static_cast<size_t>(dataSetSize / 64 + 1));
+
+		for (int i = 0; i < dataSetSize; i++)
+		{
+			lockFreeTable.insert(i, 0);
+			shardedTable.insert(i, 0);
+		}
+
+		double lockFree = measureThreads(threads, operationsPerThread, [&lockFreeTable, dataSetSize](std::mt19937& generator, int i)
+		{
+			int key = generator() % dataSetSize;
+			int value;
+
+			if (i % 10 == 0)
+				lockFreeTable.add(key, 1);
+			else
+				lockFreeTable.find(key, value);
+		});
+
+		double sharded = measureThreads(threads, operationsPerThread, [&shardedTable, dataSetSize](std::mt19937& generator, int i)
+		{
+			int key = generator() % dataSetSize;
+
+			if (i % 10 == 0)
+				shardedTable.update(key, [](int& value) { value++; });
+			else
+				shardedTable.contains(key);
+		});
+
+		std::cout << threads << " threads: " << lockFree << " Mops/s (lock-free), " << sharded << " Mops/s (64 shards)\n";
+	}
+}
+
+// Check the concurrent cuckoo table under threadCount threads, throws std::logic_error if an invariant broke.
+// The table starts small, so inserts keep moving keys along cuckoo paths and growing it while readers run
+void stressConcurrentCuckooTable(int threadCount, int keysPerThread)
+{
+	ConcurrentCuckooTable<int, int> table(64);
+	const int keyRange = threadCount * keysPerThread;
+	std::atomic<int> wrongValues(0);
+	std::vector<std::thread> threads;
+
+	// Every thread inserts its own keys and reads random keys of the others in between
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&table, &wrongValues, keysPerThread, keyRange, t]()
+		{
+			std::mt19937 generator(t + 1);
+			int value;
+
+			for (int i = 0; i < keysPerThread; i++)
+			{
+				table.insert(t * keysPerThread + i, (t * keysPerThread + i) * 2);
+
+				int key = static_cast<int>(generator() % keyRange);
+
+				if (table.find(key, value) && value != key * 2)
+					wrongValues++;
+
+				// A key of this thread is never moved out of the table, only along it
+				key = t * keysPerThread + static_cast<int>(generator() % (i + 1));
+
+				if (!table.find(key, value) || value != key * 2)
+					wrongValues++;
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (int key = 0; key < keyRange; key++)
+	{
+		int value;
+
+		if (!table.find(key, value) || value != key * 2)
+			throw std::logic_error("An inserted key is missing");
+	}
+
+	if (table.getSize() != static_cast<size_t>(keyRange))
+		throw std::logic_error("The size does not match the number of keys");
+
+	// Removals and re-inserts racing with readers
+	measureThreads(threadCount, keysPerThread, [&table, &wrongValues, keyRange](std::mt19937& generator, int i)
+	{
+		int key = static_cast<int>(generator() % keyRange);
+		int value;
+
+		if (i % 4 == 0)
+			table.tryRemove(key);
+		else if (i % 4 == 1)
+			table.insert(key, key * 2);
+		else if (table.find(key, value) && value != key * 2)
+			wrongValues++;
+	});
+
+	if (wrongValues != 0)
+		throw std::logic_error("Read a wrong value or missed a key that was there");
+
+	std::cout << "Concurrent cuckoo table: " << threadCount << " threads passed, " << table.getCapacity() << " slots\n";
+}
+
+// Compare the concurrent cuckoo table against cuckoo tables behind one lock and behind 64 shard locks,
+// on 90% lookups, 5% inserts and 5% removals of random keys, from 1 to maxThreads threads
+void compareConcurrentCuckoo(int dataSetSize, int maxThreads)
+{
+	const int operationsPerThread = 1000000;
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		ConcurrentCuckooTable<int, int> concurrentTable(dataSetSize);
+		ShardedTable<int, int, CuckooHashingTable<int, int>> globalTable(1, static_cast<size_t>(dataSetSize));
+		ShardedTable<int, int, CuckooHashingTable<int, int>> shardedTable(64, static_cast<size_t>(dataSetSize / 64 + 1));
+
+		for (int i = 0; i < dataSetSize; i += 2)
+		{
+			concurrentTable.insert(i, i);
+			globalTable.insert(i, i);
+			shardedTable.insert(i, i);
+		}
+
+		double concurrent = measureThreads(threads, operationsPerThread, [&concurrentTable, dataSetSize](std::mt19937& generator, int i)
+		{
+			int key = generator() % dataSetSize;
+			int operation = generator() % 20;
+			int value;
+
+			if (operation == 0)
+				concurrentTable.insert(key, i);
+			else if (operation == 1)
+				concurrentTable.tryRemove(key);
+			else
+				concurrentTable.find(key, value);
+		});
+
+		std::cout << threads << " threads: " << concurrent << " Mops/s (optimistic), "
+			<< measureConcurrentThroughput(globalTable, dataSetSize, operationsPerThread, threads) << " Mops/s (one lock), "
+			<< measureConcurrentThroughput(shardedTable, dataSetSize, operationsPerThread, threads) << " Mops/s (64 shards)\n";
+	}
+}
+
+// Check the lock-free chaining table under threadCount threads, throws std::logic_error if an invariant broke.
+// Few buckets keep the chains long and every thread removes and re-inserts keys others are reading, so
+// removed nodes are unlinked and freed while readers are still walking past them. The values are strings,
+// a node freed too early shows up as a wrong value or as a use after free in a sanitizer build
+void stressLockFreeChainingTable(int threadCount, int keysPerThread)
+{
+	LockFreeChainingTable<int, std::string> table(64);
+	const int keyRange = threadCount * keysPerThread;
+	std::atomic<int> wrongValues(0);
+	std::vector<std::thread> threads;
+
+	// Every thread inserts its own keys and reads random keys of the others in between
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&table, &wrongValues, keysPerThread, keyRange, t]()
+		{
+			std::mt19937 generator(t + 1);
+			std::string value;
+
+			for (int i = 0; i < keysPerThread; i++)
+			{
+				table.insert(t * keysPerThread + i, std::to_string(t * keysPerThread + i));
+
+				int key = static_cast<int>(generator() % keyRange);
+
+				if (table.find(key, value) && value != std::to_string(key))
+					wrongValues++;
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (int key = 0; key < keyRange; key++)
+	{
+		if (!table.contains(key))
+			throw std::logic_error("An inserted key is missing");
+	}
+
+	// Every thread removes and re-inserts its own keys while reading everyone's: a key of this thread
+	// must be there exactly when this thread last put it back
+	threads.clear();
+
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&table, &wrongValues, keysPerThread, keyRange, t]()
+		{
+			std::mt19937 generator(t + 1);
+			std::vector<bool> present(keysPerThread, true);
+			std::string value;
+
+			for (int i = 0; i < keysPerThread * 4; i++)
+			{
+				int own = static_cast<int>(generator() % keysPerThread);
+				int key = t * keysPerThread + own;
+
+				if (present[own] ? !table.tryRemove(key) : !table.insert(key, std::to_string(key)))
+					wrongValues++;
+
+				present[own] = !present[own];
+
+				if (table.contains(key) != present[own])
+					wrongValues++;
+
+				key = static_cast<int>(generator() % keyRange);
+
+				if (table.find(key, value) && value != std::to_string(key))
+					wrongValues++;
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (wrongValues != 0)
+		throw std::logic_error("Read a wrong value or a key in the wrong state");
+
+	std::cout << "Lock-free chaining table: " << threadCount << " threads passed\n";
+}
+
+// Compare the lock-free chaining table against chaining tables behind one lock and behind 64 shard locks,
+// on 90% lookups, 5% inserts and 5% removals of random keys, from 1 to maxThreads threads
+void compareLockFreeChaining(int dataSetSize, int maxThreads)
+{
+	const int operationsPerThread = 1000000;
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		LockFreeChainingTable<int, int> lockFreeTable(dataSetSize);
+		ShardedTable<int, int, ClosedAddressingTable<int, int>> globalTable(1, static_cast<size_t>(dataSetSize));
+		ShardedTable<int, int, ClosedAddressingTable<int, int>> shardedTable(64, static_cast<size_t>(dataSetSize / 64 + 1));
+
+		for (int i = 0; i < dataSetSize; i += 2)
+		{
+			lockFreeTable.insert(i, i);
+			globalTable.insert(i, i);
+			shardedTable.insert(i, i);
+		}
+
+		double lockFree = measureThreads(threads, operationsPerThread, [&lockFreeTable, dataSetSize](std::mt19937& generator, int i)
+		{
+			int key = generator() % dataSetSize;
+			int operation = generator() % 20;
+
+			if (operation == 0)
+				lockFreeTable.insert(key, i);
+			else if (operation == 1)
+				lockFreeTable.tryRemove(key);
+			else
+				lockFreeTable.contains(key);
+		});
+
+		std::cout << threads << " threads: " << lockFree << " Mops/s (lock-free), "
+			<< measureConcurrentThroughput(globalTable, dataSetSize, operationsPerThread, threads) << " Mops/s (one lock), "
+			<< measureConcurrentThroughput(shardedTable, dataSetSize, operationsPerThread, threads) << " Mops/s (64 shards)\n";
+	}
+}
+
+// Run inserts, lookups and removals of the keys on two equal tables, one key at a time on the first and
+// through the batch operations on the second. Lookups and removals visit the keys in another order than
+// the inserts, so tables bigger than the cache miss on nearly every key
+template <typename Table>
+void measureBatchPerformance(Table& single, Table& batched, const std::vector<int>& keys)
+{
+	std::vector<int> values(keys.size());
+	std::vector<int> lookups(keys);
+	std::vector<int*> found(keys.size());
+	Timer timer;
+
+	for (size_t i = 0; i < keys.size(); i++)
+		values[i] = keys[i] * 2;
+
+	std::shuffle(lookups.begin(), lookups.end(), std::mt19937(2));
+
+	timer.start();
+	for (size_t i = 0; i < keys.size(); i++)
+		single.insert(keys[i], values[i]);
+	timer.stop();
+	double insertTime = timer.getDuration() / keys.size();
+
+	timer.start();
+	batched.insertBatch(keys.data(), values.data(), keys.size());
+	timer.stop();
+	double insertBatchTime = timer.getDuration() / keys.size();
+
+	timer.start();
+	for (size_t i = 0; i < lookups.size(); i++)
+		found[i] = single.find(lookups[i]);
+	timer.stop();
+	double searchTime = timer.getDuration() / keys.size();
+
+	timer.start();
+	batched.findBatch(lookups.data(), lookups.size(), found.data());
+	timer.stop();
+	double searchBatchTime = timer.getDuration() / keys.size();
+
+	for (size_t i = 0; i < lookups.size(); i++)
+	{
+		if (found[i] == nullptr || *found[i] != lookups[i] * 2)
+			throw std::logic_error("A batched lookup missed an inserted key or read a wrong value");
+	}
+
+	timer.start();
+	for (size_t i = 0; i < lookups.size(); i++)
+		single.tryRemove(lookups[i]);
+	timer.stop();
+	double removeTime = timer.getDuration() / keys.size();
+
+	timer.start();
+	size_t removed = batched.removeBatch(lookups.data(), lookups.size());
+	timer.stop();
+	double removeBatchTime = timer.getDuration() / keys.size();
+
+	if (removed != keys.size())
+		throw std::logic_error("A batched removal missed an inserted key");
+
+	std::cout << "Average time (one at a time / batched): " << insertTime << "ns / " << insertBatchTime << "ns (insert), "
+		<< searchTime << "ns / " << searchBatchTime << "ns (search), " << removeTime << "ns / " << removeBatchTime << "ns (remove)\n";
+}
+
+// Compare the batch operations of every hash table with single key operations. Prefetching pays off once
+// the table no longer fits in the cache, use a few million keys
+void compareBatchOperations(int dataSetSize)
+{
+	std::vector<int> keys(dataSetSize);
+
+	for (int i = 0; i < dataSetSize; i++)
+		keys[i] = i;
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+	std::cout << "Linear probing: ";
+	OpenAddressingTable<int, int> openSingle(dataSetSize / 0.75), openBatched(dataSetSize / 0.75);
+	measureBatchPerformance(openSingle, openBatched, keys);
+
+	std::cout << "Linear probing, growing from 16 slots: ";
+	OpenAddressingTable<int, int> growingSingle(16, true), growingBatched(16, true);
+	measureBatchPerformance(growingSingle, growingBatched, keys);
+
+	std::cout << "Robin Hood: ";
+	RobinHoodHashTable<int, int> robinHoodSingle(dataSetSize / 0.75), robinHoodBatched(dataSetSize / 0.75);
+	measureBatchPerformance(robinHoodSingle, robinHoodBatched, keys);
+
+	std::cout << "Swiss table: ";
+	SwissHashTable<int, int> swissSingle(dataSetSize / 0.75), swissBatched(dataSetSize / 0.75);
+	measureBatchPerformance(swissSingle, swissBatched, keys);
+
+	std::cout << "Cuckoo hashing: ";
+	CuckooHashingTable<int, int> cuckooSingle(dataSetSize), cuckooBatched(dataSetSize);
+	measureBatchPerformance(cuckooSingle, cuckooBatched, keys);
+
+	std::cout << "Bucketized cuckoo hashing: ";
+	BucketizedCuckooTable<int, int> bucketizedSingle(dataSetSize / 0.9), bucketizedBatched(dataSetSize / 0.9);
+	measureBatchPerformance(bucketizedSingle, bucketizedBatched, keys);
+
+	std::cout << "Chaining: ";
+	ClosedAddressingTable<int, int> closedSingle(dataSetSize, true, false), closedBatched(dataSetSize, true, false);
+	measureBatchPerformance(closedSingle, closedBatched, keys);
+}
+
 #endif
\ No newline at end of file